@@ -4,10 +4,10 @@
  * Created Date: 2023-11-17 17:48:54
  * Author: 3urobeat
  *
- * Last Modified: 2024-05-21 20:45:28
+ * Last Modified: 2026-10-18 01:37:44
  * Modified By: 3urobeat
  *
- * Copyright (c) 2023 - 2024 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2023 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -17,67 +17,187 @@
 
 #include "helpers.h"
 
-
-// Specifies the IDs (min 0, max 9) which data messages are prefixed with to indicate their type
-typedef enum {
-    pingID      = 0, // Empty data message only used by server for preventing connection loss screen
-    cpuLoadID   = 1,
-    cpuTempID   = 2,
-    ramUsageID  = 3,
-    swapUsageID = 4,
-    gpuLoadID   = 5,
-    gpuTempID   = 6
-} MeasurementPrefixIDsType;
+#include <stddef.h> // offsetof
 
 
 // Stores all current measurements
 struct MeasurementTypes measurementsCache;
 
 
+// How to display every field of protocolSchema.h. Generated at compile time and kept in flash, indexed by id
+struct FieldDecoder {
+    uint8_t registerOffset; // Offset of the register in measurementsCache
+    uint8_t frameScale;     // 0 if the id is unsupported
+    uint8_t decimals;
+    char    unit[4];
+};
+
+#define PROTOCOL_DECODER_ENTRY(name, id, frameScale, decimals, unit) [id] = { offsetof(struct MeasurementTypes, name), frameScale, decimals, unit },
+
+const struct FieldDecoder fieldDecoders[protocolMaxId + 1] PROGMEM = {
+    PROTOCOL_FIELDS(PROTOCOL_DECODER_ENTRY)
+};
+
+
+/**
+ * Copies the decoder of a field from flash into dest. Returns NULL for unsupported ids, otherwise a pointer to the register of the field
+ */
+char *_getDecoder(uint8_t id, struct FieldDecoder *dest)
+{
+    if (id > protocolMaxId) return NULL;
+
+    memcpy_P(dest, &fieldDecoders[id], sizeof(struct FieldDecoder));
+
+    if (dest->frameScale == 0) return NULL; // Unsupported type
+
+    return (char *) &measurementsCache + dest->registerOffset;
+}
+
+
 // Handles incoming measurement data messages and updates measurementsCache accordingly
 void handleDataInput(char *str)
 {
-    // Get measurement type by converting char to int: https://stackoverflow.com/a/868508
-    int typeChar = str[1] - '0';
+    // Get measurement type. IDs are sent in decimal and may have more than one digit
+    const char *content = str + 1;
+    int         type    = 0;
 
-    char unit[4] = "";
+    while (*content >= '0' && *content <= '9')
+    {
+        type = type * 10 + (*content - '0');
+        content++;
+    }
+
+    if (*content != '-' || type > protocolMaxId) return; // Malformed message
+
+    struct FieldDecoder decoder;
 
 
     // Write into the correct register
-    char *registerP = NULL; // Point to register so we can dedup the code below
+    char *registerP = _getDecoder(type, &decoder); // Point to register so we can dedup the code below
+
+    if (registerP == NULL) return;
+
+    // Copy into the correct register, skipping control char, type id and separator. Limit by 16 - unit size to prevent overflow.
+    strncpy(registerP, content + 1, dataSize - sizeof(decoder.unit));
+    strcat(registerP, decoder.unit);
+}
+
+
+/**
+ * Formats a field of a binary frame and writes it into the correct register of measurementsCache
+ */
+void _handleFrameField(uint8_t id, uint16_t value)
+{
+    struct FieldDecoder decoder;
+
+    char *registerP = _getDecoder(id & ~frameInvalidFlag, &decoder);
+
+    if (registerP == NULL) return;
+
+    // Sensor has no value, display placeholder like on startup
+    if (id & frameInvalidFlag)
+    {
+        strcpy(registerP, (decoder.unit[0] == '%') ? "/ " : "/  ");
+        return;
+    }
 
-    switch (typeChar)
+    // Show one decimal below 100 if the field has one, like the server does for the text protocol
+    uint16_t scale = decoder.frameScale;
+
+    if (decoder.decimals > 0 && scale > 1 && value < 100 * scale) sprintf(registerP, "%u.%u", (unsigned int) (value / scale), (unsigned int) ((value % scale) * 10 / scale));
+        else sprintf(registerP, "%u", (unsigned int) ((value + scale / 2) / scale));
+
+    strcat(registerP, decoder.unit);
+}
+
+
+// Persistent data for handleFrameByte(). A frame may arrive across multiple serialEvent calls
+enum FrameDecoderState {
+    FRAME_IDLE = 0,
+    FRAME_HEADER,  // Waiting for version & length
+    FRAME_PAYLOAD,
+    FRAME_CRC
+};
+
+#define frameMaxPayload 30 // 10 fields
+
+enum FrameDecoderState frameDecoderState = FRAME_IDLE;
+uint8_t frameBuffer[2 + frameMaxPayload]; // Version, length & payload, which is exactly what the CRC covers
+uint8_t frameReceived = 0;
+bool    frameIsSnapshot = false;
+
+/**
+ * Returns true if the frame decoder is not in the middle of a frame
+ */
+bool frameDecoderIsIdle()
+{
+    return frameDecoderState == FRAME_IDLE;
+}
+
+
+/**
+ * Returns true if byte starts a frame or snapshot frame
+ */
+bool isFrameStartByte(int byte)
+{
+    return byte == frameStartByte || byte == frameSnapshotStartByte;
+}
+
+
+/**
+ * Feeds one byte into the binary frame decoder. Returns FRAME_COMPLETE or FRAME_SNAPSHOT when a frame with a valid CRC was received and applied to measurementsCache, FRAME_ERROR if a corrupted frame was dropped
+ */
+enum FrameResult handleFrameByte(uint8_t byte)
+{
+    switch (frameDecoderState)
     {
-        case cpuLoadID:
-            registerP = measurementsCache.cpuLoad;
-            strcpy(unit, "%");
-            break;
-        case cpuTempID:
-            registerP = measurementsCache.cpuTemp;
-            strcpy(unit, "°C");
-            break;
-        case ramUsageID:
-            registerP = measurementsCache.ramUsage;
-            strcpy(unit, "GB");
-            break;
-        case swapUsageID:
-            registerP = measurementsCache.swapUsage;
-            strcpy(unit, "GB");
-            break;
-        case gpuLoadID:
-            registerP = measurementsCache.gpuLoad;
-            strcpy(unit, "%");
-            break;
-        case gpuTempID:
-            registerP = measurementsCache.gpuTemp;
-            strcpy(unit, "°C");
-            break;
-        default:
-            return; // Unsupported type
-            break;
+        case FRAME_IDLE:
+            if (isFrameStartByte(byte))
+            {
+                frameDecoderState = FRAME_HEADER;
+                frameReceived     = 0;
+                frameIsSnapshot   = (byte == frameSnapshotStartByte);
+            }
+            return FRAME_INCOMPLETE;
+
+        case FRAME_HEADER:
+            frameBuffer[frameReceived++] = byte;
+
+            if (frameReceived == 1 && byte != frameVersion) // Unsupported version, wait for the next frame
+            {
+                frameDecoderState = FRAME_IDLE;
+                return FRAME_ERROR;
+            }
+
+            if (frameReceived == 2)
+            {
+                if (byte > frameMaxPayload || byte % frameFieldSize != 0) // Invalid length, wait for the next frame
+                {
+                    frameDecoderState = FRAME_IDLE;
+                    return FRAME_ERROR;
+                }
+
+                frameDecoderState = (byte == 0) ? FRAME_CRC : FRAME_PAYLOAD;
+            }
+            return FRAME_INCOMPLETE;
+
+        case FRAME_PAYLOAD:
+            frameBuffer[frameReceived++] = byte;
+
+            if (frameReceived == 2 + frameBuffer[1]) frameDecoderState = FRAME_CRC;
+            return FRAME_INCOMPLETE;
+
+        case FRAME_CRC:
+            frameDecoderState = FRAME_IDLE;
+
+            if (crc8(frameBuffer, frameReceived) != byte) return FRAME_ERROR; // Corrupted, drop it
+
+            for (uint8_t i = 2; i < frameReceived; i += frameFieldSize)
+            {
+                _handleFrameField(frameBuffer[i], (uint16_t) (frameBuffer[i + 1] | (frameBuffer[i + 2] << 8)));
+            }
+            return frameIsSnapshot ? FRAME_SNAPSHOT : FRAME_COMPLETE;
     }
 
-    // Copy into the correct register, offset by 3 to skip control char, separator and type id. Limit by 16 - unit size to prevent overflow.
-    strncpy(registerP, str + 3, dataSize - sizeof(unit));
-    strcat(registerP, unit);
+    return FRAME_INCOMPLETE;
 }
@@ -4,10 +4,10 @@
  * Created Date: 2023-11-17 17:18:28
  * Author: 3urobeat
  *
- * Last Modified: 2024-05-21 20:45:20
+ * Last Modified: 2026-10-18 01:37:44
  * Modified By: 3urobeat
  *
- * Copyright (c) 2023 - 2024 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2023 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -35,13 +35,26 @@ struct MeasurementTypes {
 extern struct MeasurementTypes measurementsCache;
 
 
+// Result of feeding a byte into the binary frame decoder
+enum FrameResult {
+    FRAME_INCOMPLETE = 0,
+    FRAME_COMPLETE,
+    FRAME_SNAPSHOT, // Complete snapshot frame, the server waits for our acknowledgement
+    FRAME_ERROR
+};
+
+
 // Functions defined in helpers
 void handleBacklight();
 void setupBacklight();
 
 void handleDataInput(char *str);
+enum FrameResult handleFrameByte(uint8_t byte);
+bool frameDecoderIsIdle();
+bool isFrameStartByte(int byte);
 
 char *fillRow(char *str);
+uint8_t crc8(const uint8_t *data, uint8_t size);
 
 void updateDisplay();
 
@@ -49,9 +62,11 @@ void updateDisplay();
 // C++ functions need a prefix when viewed from a C++ compiler in order to allow C files to call them
 #ifdef __cplusplus
     extern "C" void setupSerial(uint32_t baudRate);
+    extern "C" void serialFlush();
     extern "C" bool serialIsAvailable();
     extern "C" void serialPrint(const char *str);
     extern "C" char serialRead();
+    extern "C" int  serialPeek();
 
     extern "C" void lcdSetupDisplay(int addr, uint8_t cols, uint8_t rows);
     extern "C" void lcdDisplaySplashScreen(const char *statusMsg);
@@ -62,9 +77,11 @@ void updateDisplay();
     extern "C" void lcdSetBacklight(uint8_t state);
 #else
     extern void setupSerial(uint32_t baudRate);
+    extern void serialFlush();
     extern bool serialIsAvailable();
     extern void serialPrint(const char *str);
     extern char serialRead();
+    extern int  serialPeek();
 
     extern void lcdSetupDisplay(int addr, uint8_t cols, uint8_t rows);
     extern void lcdDisplaySplashScreen(const char *statusMsg);
@@ -4,10 +4,10 @@
  * Created Date: 2024-05-20 21:19:31
  * Author: 3urobeat
  *
- * Last Modified: 2024-05-20 21:20:07
+ * Last Modified: 2026-10-17 19:47:05
  * Modified By: 3urobeat
  *
- * Copyright (c) 2024 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2024 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -25,3 +25,22 @@ char* fillRow(char *str)
 
     return str;
 }
+
+
+// Calculates the CRC-8 (polynomial 0x07, init 0x00) of size bytes. Must match the server's implementation
+uint8_t crc8(const uint8_t *data, uint8_t size)
+{
+    uint8_t crc = 0;
+
+    for (uint8_t i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+
+    return crc;
+}
@@ -4,10 +4,10 @@
  * Created Date: 2024-05-20 20:59:56
  * Author: 3urobeat
  *
- * Last Modified: 2024-05-20 22:07:45
+ * Last Modified: 2026-10-17 20:38:19
  * Modified By: 3urobeat
  *
- * Copyright (c) 2024 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2024 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -23,6 +23,11 @@ void setupSerial(uint32_t baudRate)
     Serial.begin(baudRate);
 }
 
+void serialFlush()
+{
+    Serial.flush(); // Waits until everything was transmitted
+}
+
 bool serialIsAvailable()
 {
     return Serial.available();
@@ -37,3 +42,8 @@ char serialRead()
 {
     return (char) Serial.read();
 }
+
+int serialPeek()
+{
+    return Serial.peek();
+}
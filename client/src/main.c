@@ -4,10 +4,10 @@
  * Created Date: 2024-05-20 21:21:42
  * Author: 3urobeat
  *
- * Last Modified: 2025-12-16 19:49:43
+ * Last Modified: 2026-10-18 10:02:37
  * Modified By: 3urobeat
  *
- * Copyright (c) 2024 - 2025 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2024 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -23,6 +23,98 @@ uint32_t timeSinceLastSignal = 0;
 uint32_t handshakeStartTimestamp = 0;
 bool     displayingSplashScreen = false;
 
+const uint32_t supportedBaudRates[] = { 115200, 57600, 38400 }; // Sorted descending
+uint32_t currentBaud         = baud;
+uint32_t baudSwitchTimestamp = 0; // Set while waiting for the server to verify a new baud rate
+uint8_t  linkErrors          = 0; // Corrupted messages in a row
+bool     creditsEnabled      = false;
+
+
+/**
+ * Returns the fastest baud rate advertised in the server's handshake header which we support, or baud
+ */
+uint32_t _selectBaudrate(const char *header)
+{
+    const char *rates = strstr(header, baudCapability);
+
+    if (rates == NULL) return baud;
+
+    rates += strlen(baudCapability);
+
+    // The server sorts its rates descending, so the first one we support is the fastest
+    while (*rates >= '0' && *rates <= '9')
+    {
+        char *end;
+        uint32_t rate = strtoul(rates, &end, 10);
+
+        for (uint8_t i = 0; i < sizeof(supportedBaudRates) / sizeof(supportedBaudRates[0]); i++)
+        {
+            if (supportedBaudRates[i] == rate) return rate;
+        }
+
+        rates = (*end == ',') ? end + 1 : end;
+    }
+
+    return baud;
+}
+
+
+/**
+ * Switches the serial connection to another baud rate after everything was transmitted
+ */
+void _switchBaudrate(uint32_t rate)
+{
+    serialFlush();
+    setupSerial(rate);
+
+    currentBaud = rate;
+    linkErrors  = 0;
+}
+
+
+/**
+ * Tells the server that we processed a message and are ready for the next one
+ */
+void _grantCredit()
+{
+    if (!creditsEnabled) return;
+
+    serialPrint(serialHeader);
+    serialPrint("!1"); // Char ! indicates credit message
+    serialPrint(serialEOL);
+}
+
+
+/**
+ * Tells the server that we painted the snapshot it sent
+ */
+void _acknowledgeSnapshot()
+{
+    serialPrint(serialHeader);
+    serialPrint("="); // Char = indicates snapshot acknowledgement
+    serialPrint(serialEOL);
+}
+
+
+/**
+ * Counts a corrupted message. Asks the server to fall back and switches back to baud if too many arrived in a row
+ */
+void _handleLinkError()
+{
+    if (currentBaud == baud) return; // Nothing slower to fall back to
+
+    linkErrors++;
+
+    if (linkErrors < linkErrorThreshold) return;
+
+    serialPrint(serialHeader);
+    serialPrint("*"); // Char * indicates interrupt message
+    serialPrint("BAUD_FALLBACK");
+    serialPrint(serialEOL);
+
+    _switchBaudrate(baud);
+}
+
 
 // Setup stuff on poweron
 void setup_c()
@@ -60,6 +152,13 @@ void loop_c()
     // Check if backlight should be toggled on every tick
     handleBacklight();
 
+    // Switch back if the server did not verify the new baud rate in time
+    if (baudSwitchTimestamp != 0 && millis() - baudSwitchTimestamp > baudVerifyTimeout)
+    {
+        _switchBaudrate(baud);
+        baudSwitchTimestamp = 0;
+    }
+
     // Count checkInterval and display Lost Connection message after 10 seconds
     if (timeSinceLastSignal >= 10000)
     {
@@ -74,6 +173,9 @@ void loop_c()
         displayingSplashScreen = true;
 
         lcdDisplaySplashScreen("Lost Connection!");
+
+        // The next server handshakes at baud. It does not reset us when connecting anymore, so we need to switch back on our own
+        if (currentBaud != baud) _switchBaudrate(baud);
     }
     else
     {
@@ -87,6 +189,31 @@ void loop_c()
 // SerialEvent occurs whenever a new data is being recieved and runs between loop() iterations
 void serialEvent_c()
 {
+    // Binary frames are decoded byte by byte. A frame may arrive across multiple calls, so the decoder keeps its state
+    while (serialIsAvailable() && (!frameDecoderIsIdle() || isFrameStartByte(serialPeek())))
+    {
+        enum FrameResult result = handleFrameByte((uint8_t) serialRead());
+
+        if (result == FRAME_ERROR) _handleLinkError();
+        if (result != FRAME_COMPLETE && result != FRAME_SNAPSHOT) continue;
+
+        linkErrors = 0;
+        updateDisplay();
+        _grantCredit();
+
+        if (result == FRAME_SNAPSHOT) _acknowledgeSnapshot(); // Only sent by servers we echoed snapshotCapability to
+
+        // Update connection loss check vars
+        timeSinceLastSignal = 0; // Reset time since last signal
+        displayingSplashScreen = false;
+    }
+
+    // Text messages end with "#\n". Drop the line ending left over from the previous message, otherwise it would be taken as the start of this one
+    while (serialIsAvailable() && (serialPeek() == '\n' || serialPeek() == '\r')) serialRead();
+
+    if (!serialIsAvailable()) return;
+
+
     char inputString[64] = "";
 
     // Read bytes while stream is available and buffer has space
@@ -109,14 +236,26 @@ void serialEvent_c()
     {
         handleDataInput(inputString); // Process input
         updateDisplay();              // ...and update the screen
+        _grantCredit();               // ...and request the next message
 
         // Update connection loss check vars
         timeSinceLastSignal = 0; // Reset time since last signal
         displayingSplashScreen = false;
+        linkErrors = 0;
+    }
+
+    // If transmission starts with + and contains ? then the server verifies the baud rate we just switched to
+    if (inputString[0] == '+' && strchr(inputString, '?') != NULL)
+    {
+        serialPrint(serialHeader);
+        serialPrint(strchr(inputString, '?')); // Echo rate back
+        serialPrint(serialEOL);
+
+        baudSwitchTimestamp = 0;
     }
 
     // If transmission starts with + then the server just initiated a new connection
-    if (inputString[0] == '+')
+    else if (inputString[0] == '+')
     {
         lcdCenterPrint("  Handshaking... ", 3, false); // Surrounded with spaces to overprint "Lost Connection!"
         handshakeStartTimestamp = millis();
@@ -124,7 +263,40 @@ void serialEvent_c()
         serialPrint(serialHeader);
         serialPrint("-"); // Char - indicates initial handshake
         serialPrint(version);
+
+        if (strstr(inputString, frameCapability) != NULL) serialPrint(frameCapability); // Only echo capabilities the server advertised, older servers would fail to parse our version otherwise
+
+        creditsEnabled = (strstr(inputString, creditCapability) != NULL);
+
+        if (creditsEnabled) serialPrint(creditCapability);
+
+        if (strstr(inputString, snapshotCapability) != NULL) serialPrint(snapshotCapability);
+
+        uint32_t rate = _selectBaudrate(inputString);
+
+        if (rate != baud)
+        {
+            char rateStr[16];
+            sprintf(rateStr, "%lu", (unsigned long) rate);
+
+            serialPrint(baudCapability);
+            serialPrint(rateStr);
+        }
+
         serialPrint(serialEOL);
+
+        // Switch after our response was transmitted, the server verifies the new rate next
+        if (rate != currentBaud)
+        {
+            _switchBaudrate(rate);
+            baudSwitchTimestamp = (rate != baud) ? millis() : 0;
+        }
+    }
+
+    // Anything else is garbage, e.g. because the baud rate does not match anymore
+    else if (inputString[0] != '\0' && inputString[0] != '\n' && inputString[0] != '~')
+    {
+        _handleLinkError();
     }
 
     // Clear data from inputString when it has been printed
@@ -4,10 +4,10 @@
  * Created Date: 2022-02-05 12:22:33
  * Author: 3urobeat
  *
- * Last Modified: 2025-12-16 20:43:23
+ * Last Modified: 2026-10-18 00:14:37
  * Modified By: 3urobeat
  *
- * Copyright (c) 2022 - 2025 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2022 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -21,6 +21,7 @@
 #include <Arduino.h>
 #include <stdbool.h> // Datatype bool in C
 
+#include "protocolSchema.h" // Shared with the server
 #include "helpers/helpers.h"
 
 
@@ -36,6 +37,12 @@
 #define baud 9600
 #define serialEOL "#\n"
 
+// Binary frame protocol, credit based flow control & baud rate negotiation are defined in shared/protocolSchema.h. Each is only used if the server advertises it in its handshake header
+
+// Baud rate negotiation. The handshake always runs at baud
+#define baudVerifyTimeout  1500 // Switch back to baud if the server does not verify the new rate within this many ms
+#define linkErrorThreshold 3    // Switch back to baud after this many corrupted messages in a row
+
 
 // C++ functions need a prefix when viewed from a C++ compiler in order to allow C files to call them
 #ifdef __cplusplus
@@ -0,0 +1,109 @@
+/*
+ * File: bench.c
+ * Project: arduino-resource-monitor
+ * Created Date: 2026-10-18 09:12:05
+ * Author: 3urobeat
+ *
+ * Last Modified: 2026-10-18 09:12:05
+ * Modified By: 3urobeat
+ *
+ * Copyright (c) 2026 3urobeat <https://github.com/3urobeat>
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "bench.h"
+
+
+// All benchmarks, run in this order
+const struct BenchCase benchCases[] = {
+    { "getMeasurements",   "Sample all sensors from fixture files (AMD layout)",    benchGetMeasurements },
+    { "cpuLoad",           "Parse '/proc/stat' of a 256 core machine",              benchCpuLoad },
+    { "meminfo",           "Parse a 6 KB '/proc/meminfo' with 150 hugepage lines",  benchMeminfo },
+    { "measurementUpdate", "Emit & compare the 6 displayed metrics",                benchMeasurementUpdate }
+};
+
+#define benchCasesAmount (sizeof(benchCases) / sizeof(benchCases[0]))
+
+
+/**
+ * Returns the current CLOCK_MONOTONIC time in ns
+ */
+uint64_t benchGetNs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+/**
+ * Prints the average time per iteration of a benchmark
+ */
+void benchReport(const char *name, uint64_t iterations, uint64_t elapsedNs)
+{
+    printf("%-24s %10lu iterations %12.1f ns/iteration\n", name, (unsigned long) iterations, (double) elapsedNs / iterations);
+}
+
+
+/**
+ * Opens a fixture file into a persistent file handle, exits if it does not exist
+ */
+void benchOpenFixture(struct FileHandle *handle, const char *name)
+{
+    char path[256];
+
+    snprintf(path, sizeof(path), "%s%s", BENCH_FIXTURE_DIR, name);
+
+    if (!fileHandleOpen(handle, path))
+    {
+        printf("\033[91mError:\033[0m Failed to open fixture '%s'! Error: %s\n", path, strerror(errno));
+        exit(1);
+    }
+}
+
+
+// Only needed by comm/, which is never used by the benchmarks
+void reconnect() {}
+
+
+/**
+ * Entry point. Runs all benchmarks or only those whose names were passed as arguments
+ */
+int main(int argc, char *argv[])
+{
+    // Settings the samplers depend on. Defaults of the config file
+    config.checkInterval     = 1000;
+    config.sampleInterval    = 250;
+    config.sampleAggregation = AGGREGATE_MAX;
+    config.gpuType           = AMD;
+    config.cpuLoadMode       = AVERAGE;
+
+    config.sampleIntervals.cpuLoad  = config.sampleInterval;
+    config.sampleIntervals.cpuTemp  = config.sampleInterval;
+    config.sampleIntervals.ramUsage = config.sampleInterval;
+    config.sampleIntervals.gpuLoad  = config.sampleInterval;
+    config.sampleIntervals.gpuTemp  = config.sampleInterval;
+
+    for (size_t i = 0; i < benchCasesAmount; i++)
+    {
+        bool selected = (argc < 2);
+
+        for (int j = 1; j < argc; j++)
+        {
+            if (strcmp(argv[j], benchCases[i].name) == 0) selected = true;
+        }
+
+        if (!selected) continue;
+
+        printf("%s: %s\n", benchCases[i].name, benchCases[i].description);
+        benchCases[i].run();
+    }
+
+    return 0;
+}
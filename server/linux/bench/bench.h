@@ -0,0 +1,45 @@
+/*
+ * File: bench.h
+ * Project: arduino-resource-monitor
+ * Created Date: 2026-10-18 09:12:05
+ * Author: 3urobeat
+ *
+ * Last Modified: 2026-10-18 09:12:05
+ * Modified By: 3urobeat
+ *
+ * Copyright (c) 2026 3urobeat <https://github.com/3urobeat>
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "../src/server.h"
+
+
+// Directory containing the '/proc' & sysfs fixtures, set by CMake
+#ifndef BENCH_FIXTURE_DIR
+    #define BENCH_FIXTURE_DIR "bench/fixtures/"
+#endif
+
+
+// Describes one benchmark. Cases are listed in bench.c and can be selected by name on the command line
+struct BenchCase {
+    const char *name;
+    const char *description;
+    void      (*run)();
+};
+
+
+// Functions to export
+extern uint64_t benchGetNs();
+extern void benchReport(const char *name, uint64_t iterations, uint64_t elapsedNs);
+extern void benchOpenFixture(struct FileHandle *handle, const char *name);
+
+extern void benchGetMeasurements();
+extern void benchCpuLoad();
+extern void benchMeminfo();
+extern void benchMeasurementUpdate();
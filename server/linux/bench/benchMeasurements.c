@@ -0,0 +1,82 @@
+/*
+ * File: benchMeasurements.c
+ * Project: arduino-resource-monitor
+ * Created Date: 2026-10-18 10:06:44
+ * Author: 3urobeat
+ *
+ * Last Modified: 2026-10-18 10:06:44
+ * Modified By: 3urobeat
+ *
+ * Copyright (c) 2026 3urobeat <https://github.com/3urobeat>
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "bench.h"
+
+
+#define benchUpdateIterations 2000000
+#define benchDisplayedMetrics 6 // CPU_LOAD to GPU_TEMP
+
+// Change detection internal to sendMeasurements.c
+extern bool _exceedsDeadband(enum MeasurementIndex index, uint64_t now);
+extern void _markSent(enum MeasurementIndex index, uint64_t now);
+
+
+/**
+ * Runs one update like the sampler & writer do: Feeds a sample into every displayed metric, emits them and formats only the ones that changed
+ */
+void _benchUpdate(int32_t offset, uint64_t now)
+{
+    static const int32_t values[benchDisplayedMetrics] = { 123, 451, 12345, 0, 420, 512 }; // Realistic values in the units of enum MeasurementIndex
+
+    char str[dataSize];
+
+    for (int i = 0; i < benchDisplayedMetrics; i++)
+    {
+        addSample(i, values[i] + offset);
+    }
+
+    emitMeasurements();
+    measurements = sampledMeasurements; // What consumeMeasurements() does on the main thread
+
+    for (int i = 0; i < benchDisplayedMetrics; i++)
+    {
+        if (!_exceedsDeadband(i, now)) continue;
+
+        formatMeasurement(str, sizeof(str), i, &measurements.m[i]);
+        _markSent(i, now);
+    }
+}
+
+
+/**
+ * Measures one emit & compare cycle of all displayed metrics, once with values that never change and once with values that change every update. Deadbands are 0
+ */
+void benchMeasurementUpdate()
+{
+    memset(&config.deadbands, 0, sizeof(config.deadbands));
+
+    _benchUpdate(0, 0); // Mark every metric as sent
+
+    uint64_t start = benchGetNs();
+
+    for (int i = 0; i < benchUpdateIterations; i++)
+    {
+        _benchUpdate(0, i);
+    }
+
+    benchReport("steady values", benchUpdateIterations, benchGetNs() - start);
+
+    start = benchGetNs();
+
+    for (int i = 0; i < benchUpdateIterations; i++)
+    {
+        _benchUpdate(1 + (i & 1), i); // Alternate between two values so that every update differs from the last one sent
+    }
+
+    benchReport("changing values", benchUpdateIterations, benchGetNs() - start);
+}
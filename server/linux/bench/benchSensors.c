@@ -0,0 +1,109 @@
+/*
+ * File: benchSensors.c
+ * Project: arduino-resource-monitor
+ * Created Date: 2026-10-18 09:12:05
+ * Author: 3urobeat
+ *
+ * Last Modified: 2026-10-18 09:12:05
+ * Modified By: 3urobeat
+ *
+ * Copyright (c) 2026 3urobeat <https://github.com/3urobeat>
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "bench.h"
+
+
+#define benchMeasurementsIterations 5000
+#define benchCpuLoadIterations      5000
+#define benchMeminfoIterations      100000
+
+
+// Samplers internal to getMeasurements.c
+extern void _getCpuLoad();
+
+
+/**
+ * Measures one sampler tick of all sensors. '/proc/stat', '/proc/meminfo' and the AMD hwmon files are replaced by fixtures
+ */
+void benchGetMeasurements()
+{
+    strcpy(sensorPaths.cpuTemp, "cpuTemp");
+    strcpy(sensorPaths.gpuLoad, "gpuLoad");
+    strcpy(sensorPaths.gpuTemp, "gpuTemp");
+
+    benchOpenFixture(&sensorHandles.procStat, "stat");
+    benchOpenFixture(&sensorHandles.procMeminfo, "meminfo");
+    benchOpenFixture(&sensorHandles.cpuTemp, "cpuTemp");
+    benchOpenFixture(&sensorHandles.gpuLoad, "gpuLoad");
+    benchOpenFixture(&sensorHandles.gpuTemp, "gpuTemp");
+
+    getMeasurements(); // Warm up page cache & learn meminfo offsets
+
+    uint64_t start = benchGetNs();
+
+    for (int i = 0; i < benchMeasurementsIterations; i++)
+    {
+        getMeasurements();
+    }
+
+    benchReport("getMeasurements()", benchMeasurementsIterations, benchGetNs() - start);
+}
+
+
+/**
+ * Measures reading and parsing '/proc/stat' of a 256 core machine. Alternates between two snapshots so that every core reports a load
+ */
+void benchCpuLoad()
+{
+    struct FileHandle snapshots[2] = { { .fd = -1 }, { .fd = -1 } };
+
+    benchOpenFixture(&snapshots[0], "stat256");
+    benchOpenFixture(&snapshots[1], "stat256Next");
+
+    fileHandleClose(&sensorHandles.procStat); // Snapshots are swapped in below
+    sensorHandles.procStat = snapshots[1];
+    _getCpuLoad(); // Initialize counters
+
+    uint64_t start = benchGetNs();
+
+    for (int i = 0; i < benchCpuLoadIterations; i++)
+    {
+        sensorHandles.procStat = snapshots[i % 2];
+        _getCpuLoad();
+    }
+
+    benchReport("_getCpuLoad()", benchCpuLoadIterations, benchGetNs() - start);
+
+    if (sampledCpuCoreStats.coreCount != 256) printf("\033[33mWarn:\033[0m Parsed %u cores instead of 256!\n", sampledCpuCoreStats.coreCount);
+
+    sensorHandles.procStat = (struct FileHandle) { .fd = -1 };
+
+    fileHandleClose(&snapshots[0]);
+    fileHandleClose(&snapshots[1]);
+}
+
+
+/**
+ * Measures reading RAM & Swap usage from a '/proc/meminfo' with 150 extra lines in front of SwapTotal & SwapFree, as found on hosts with many hugepage pools
+ */
+void benchMeminfo()
+{
+    fileHandleClose(&sensorHandles.procMeminfo);
+    benchOpenFixture(&sensorHandles.procMeminfo, "meminfoHugepages");
+
+    sampleMemory(); // Learn line offsets
+
+    uint64_t start = benchGetNs();
+
+    for (int i = 0; i < benchMeminfoIterations; i++)
+    {
+        sampleMemory();
+    }
+
+    benchReport("sampleMemory()", benchMeminfoIterations, benchGetNs() - start);
+}
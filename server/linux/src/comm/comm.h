@@ -4,10 +4,10 @@
  * Created Date: 2024-05-26 14:01:12
  * Author: 3urobeat
  *
- * Last Modified: 2025-12-16 18:55:05
+ * Last Modified: 2026-10-18 08:56:13
  * Modified By: 3urobeat
  *
- * Copyright (c) 2024 - 2025 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2024 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -22,18 +22,125 @@
 #define serialClientHeader "+ResourceMonitorClient"
 #define serialEOL '#'
 
+
+// Protocol used to send measurements. Frame layout, IDs and capabilities are defined in shared/protocolSchema.h
+enum ProtocolType {
+    PROTOCOL_TEXT  = 0, // One '~<id>-<value>#' message per measurement, understood by every client
+    PROTOCOL_FRAME = 1  // All changed measurements in one binary frame
+};
+
+extern enum ProtocolType negotiatedProtocol;
+
+
+// Snapshot frames. After a handshake or reset the client receives its whole state in one frame instead of being refreshed field by field
+#define snapshotAckTimeout 1000 // Resend the snapshot if the client did not acknowledge it within this many ms
+
+extern bool snapshotSupported;
+
+
+// Baud rate negotiation. The handshake always runs at baud, the server advertises the faster rates it supports with baudCapability.
+// The client echoes the highest rate it supports as well, both switch and the server verifies the link with a '?' message before using it
+#define baudVerifyTimeout 1000  // How long to wait for the client to answer the verification message in ms
+#define linkErrorThreshold 3    // Fall back to a slower rate after this many corrupted messages from the client
+#define headerParseTime 2000      // Worst case for the client to read our header and respond, it reads one char every 25ms
+#define headerRepeatInterval 2500 // Send our header again to devices which did not respond after this many ms. Must exceed headerParseTime, the client's receive buffer overflows otherwise
+
+extern uint32_t negotiatedBaud;
+
+
+// Credit based flow control. The client grants a credit with a '!<amount>' message after it processed a message and updated the display
+#define creditWindow     2      // Messages that may be in flight, limited by the client's 64 byte receive buffer
+#define creditTimeout    1000   // Assume the credit got lost after waiting this many ms
+#define legacySendDelay  500    // Minimum time between two messages in ms for clients without flow control
+
+enum SerialMessageResult {
+    SERIAL_MESSAGE_NONE = 0, // Timeout passed without a complete message
+    SERIAL_MESSAGE_COMPLETE,
+    SERIAL_MESSAGE_GARBAGE,  // Received a null byte or an overlong message, usually caused by a baud rate mismatch
+    SERIAL_MESSAGE_ERROR
+};
+
+struct LatencyStats {
+    uint64_t count;
+    uint64_t sumMs;
+    uint64_t maxMs;
+};
+
+struct LinkStats {
+    uint64_t connectedSince;    // CLOCK_MONOTONIC ms
+    uint64_t messagesWritten;
+    uint64_t bytesWritten;
+    uint64_t stalls;            // Amount of times a message had to wait for a credit
+    uint64_t stallMs;           // Total time spent waiting for credits
+    uint64_t creditTimeouts;    // Amount of times a credit did not arrive within creditTimeout
+    uint64_t snapshotsSent;
+    uint64_t paintMs;           // Time from the last handshake or reset until the client displayed all measurements, 0 if it did not yet
+    struct LatencyStats transmitLatency; // Time from writing a message until the kernel transmitted its last byte
+    struct LatencyStats creditLatency;   // Time from writing a message until the client granted its credit back, i.e. processed it
+};
+
+extern bool creditFlowControl;
+
 // Functions to export
 extern void makeConnection();
-extern void checkForClientInterrupt();
+extern void handleClientMessages();
 
 extern void sendMeasurements();
+extern void flushSendQueue();
+extern int  sendGetTimerFd();
 extern void logMeasurements();
 extern void resetCache();
+extern void requestSnapshot();
+extern void snapshotAcknowledged();
+extern void addCredits(uint32_t amount);
+extern void resetFlowControl(bool useCredits);
+extern void resetLinkStats();
+extern void linkPrintStats();
 
 extern bool serialNewConnection(const char *port, uint32_t baudRate);
 extern bool serialIsOpen();
 extern void serialClose();
 extern void serialFlushOutput();
+extern bool serialSetBaudrate(uint32_t baudRate);
+extern void serialDiscardInput();
 extern bool serialWrite(const char *data, size_t size); // Returns bool if write succeeded/failed
-extern bool serialRead(char *dest, uint32_t timeout); // Returns bool if read succeeded/failed
+extern enum SerialMessageResult serialReadMessage(char *dest, size_t size, uint32_t timeout); // Waits up to timeout ms for the next complete message, without its end char. 0 only handles what already arrived
+extern int  serialOutputWaiting(); // Returns amount of bytes the kernel did not transmit yet or -1 on error
+extern int  serialGetFd();
 extern char *serialGetPort();
+
+#define maxSerialProbes 32 // Amount of ports makeConnection() handshakes with concurrently
+
+extern bool serialProbeOpen(int probe, const char *port, uint32_t baudRate); // Opens a port for a concurrent handshake in slot probe
+extern void serialProbeClose(int probe);
+extern bool serialProbeResetDevice(int probe); // Pulses DTR to reset the Arduino, also drops everything received so far
+extern bool serialProbeWrite(int probe, const char *data, size_t size);
+extern enum SerialMessageResult serialProbeReadMessage(int probe, char *dest, size_t size, uint32_t timeout);
+extern int  serialProbeGetFd(int probe);
+extern char *serialProbeGetPort(int probe);
+extern void serialProbeSelect(int probe); // Makes the port of probe the connection all other serial functions use
+
+
+// Ports are probed in the order of their rank, see portIndex.c
+enum PortRank {
+    PORT_RANK_PREFERRED = 0, // Matches the configured serialNumber or is the device we were last connected to
+    PORT_RANK_KNOWN,         // USB ID of an Arduino or a common USB-serial chip
+    PORT_RANK_OTHER
+};
+
+struct PortCandidate {
+    char path[32];
+    char vendorId[8];        // Empty if the port does not belong to a USB device
+    char productId[8];
+    char serial[64];         // Empty if the device has no serial number, e.g. most CH340 clones
+    enum PortRank rank;
+};
+
+extern const char *portRankNames[];
+
+#define lastPortWaitTimeout  5000 // How long to wait in ms for the last used port to re-appear before scanning all ports. Only if it vanished while we were connected
+#define lastPortReplyTimeout 3000 // Timeout in ms for the handshake on the last used port, the Arduino is usually still there. Must exceed headerRepeatInterval to reset it if it does not answer
+
+extern int  buildPortIndex(struct PortCandidate *dest, int size); // Returns amount of USB serial ports found, sorted by rank
+extern void rememberPort(const struct PortCandidate *candidate);
+extern bool getLastPort(struct PortCandidate *dest, uint32_t timeout);
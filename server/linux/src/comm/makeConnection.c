@@ -4,10 +4,10 @@
  * Created Date: 2023-11-15 22:31:32
  * Author: 3urobeat
  *
- * Last Modified: 2025-12-22 15:37:03
+ * Last Modified: 2026-10-18 08:56:13
  * Modified By: 3urobeat
  *
- * Copyright (c) 2023 - 2025 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2023 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -17,7 +17,7 @@
 
 #include "comm.h"
 
-#include <dirent.h>
+#include <inttypes.h>
 
 
 /**
@@ -25,39 +25,22 @@
  */
 bool _readSerialIntoBuffer(char *dest, uint32_t size, uint32_t timeout)
 {
-    // Get current time
-    struct timespec timeStruct;
-    clock_gettime(CLOCK_REALTIME, &timeStruct);
-    const time_t timestamp = timeStruct.tv_sec * 1000L;
+    uint64_t deadline = getMonotonicMs() + timeout;
 
+    enum SerialMessageResult result;
 
-    // Read response as long as port is open, we haven't run into timeout and buffer has enough space
-    uint32_t offset = 0;
+    // Skip garbage, e.g. bytes sent by the client while it was still booting
+    do {
+        uint64_t now = getMonotonicMs();
 
-    while (serialIsOpen()
-            && timestamp + timeout > (timeStruct.tv_sec * 1000L)
-            && offset < size - 1)
-    {
-        logDebug("_readSerialIntoBuffer: Remaining time for this message: %ldms", (timestamp + timeout) - (timeStruct.tv_sec * 1000L));
-
-        // Attempt to read
-        if (!serialRead(dest + offset, timeout)) break;
+        logDebug("_readSerialIntoBuffer: Remaining time for this message: %" PRIu64 "ms", (deadline > now) ? deadline - now : 0);
 
-        // Refresh time struct
-        clock_gettime(CLOCK_REALTIME, &timeStruct);
-
-        // Do not increment iteration if nothing was read or pipeline was cleared and let next iteration overwrite char
-        if (*(dest + offset) == '\0' || *(dest + offset) == '\n') continue;
-
-        // Break loop if end char was received
-        if (*(dest + offset) == serialEOL) break;
-
-        offset++;
-    }
+        result = serialReadMessage(dest, size, (deadline > now) ? deadline - now : 0);
+    } while (result == SERIAL_MESSAGE_GARBAGE);
 
 
     // Basic success checks
-    if (strlen(dest) == 0) // No response
+    if (result != SERIAL_MESSAGE_COMPLETE) // No response
     {
         return false;
     }
@@ -72,163 +55,593 @@ bool _readSerialIntoBuffer(char *dest, uint32_t size, uint32_t timeout)
 }
 
 
+// Persistent data for baud rate negotiation. Rates are sorted descending and must be known to the client as well
+const uint32_t negotiableBaudRates[] = { 115200, 57600, 38400 }; // Keep short, the whole handshake header must fit into 62 chars for older clients
+
+#define negotiableBaudRatesAmount (sizeof(negotiableBaudRates) / sizeof(negotiableBaudRates[0]))
+
+uint32_t baudLimit      = 0;    // Index of the fastest rate we still advertise. Raised every time a rate caused link errors
+uint32_t negotiatedBaud = baud;
+uint32_t linkErrors     = 0;    // Corrupted messages received from the client in a row
+
 /**
- * Attempts to find and connect to Arduino over Serial
+ * Constructs our handshake header, advertising all capabilities
  */
-void makeConnection()
+void _buildHeader(char *dest, size_t size)
+{
+    snprintf(dest, size, "+ResourceMonitorLinuxServer-%s%s%s%s", version, frameCapability, creditCapability, snapshotCapability); // Clients which support these echo them back, older ones ignore them
+
+    if (baudLimit >= negotiableBaudRatesAmount) // All rates caused errors, stay at baud
+    {
+        strncat(dest, "#", size - strlen(dest) - 1);
+        return;
+    }
+
+    strncat(dest, baudCapability, size - strlen(dest) - 1);
+
+    for (uint32_t i = baudLimit; i < negotiableBaudRatesAmount; i++)
+    {
+        char rateStr[16];
+        snprintf(rateStr, sizeof(rateStr), (i == baudLimit) ? "%u" : ",%u", negotiableBaudRates[i]);
+
+        strncat(dest, rateStr, size - strlen(dest) - 1);
+    }
+
+    strncat(dest, "#", size - strlen(dest) - 1);
+}
+
+
+/**
+ * Parses and removes the capabilities the client appended to its version. Returns the baud rate the client wants to switch to or baud
+ */
+uint32_t _parseCapabilities(char *versionStr)
 {
-    // Get all used USB ports by iterating through /sys/class/tty/
-    DIR *dp;
-    struct dirent *ep;
-    dp = opendir("/sys/class/tty/");
+    uint32_t requestedBaud = baud;
+
+    negotiatedProtocol = PROTOCOL_TEXT;
+    snapshotSupported  = false;
+    resetFlowControl(false);
 
-    if (dp == NULL)
+    char *capabilities = strchr(versionStr, ';');
+
+    if (capabilities == NULL) return requestedBaud;
+
+    *capabilities = '\0'; // Terminate version
+
+    char *token = strtok(capabilities + 1, ";");
+
+    while (token != NULL)
     {
-        printf("\033[91mError:\033[0m Failed to open '/sys/class/tty/' to find all used USB ports!\n");
+        if (strcmp(token, frameCapability + 1) == 0)  negotiatedProtocol = PROTOCOL_FRAME;
+        if (strcmp(token, creditCapability + 1) == 0) resetFlowControl(true);
+        if (strcmp(token, snapshotCapability + 1) == 0) snapshotSupported = true;
+
+        if (strncmp(token, baudCapability + 1, strlen(baudCapability) - 1) == 0)
+        {
+            uint32_t rate = strtoul(token + strlen(baudCapability) - 1, NULL, 10);
+
+            // Only accept rates we advertised
+            for (uint32_t i = baudLimit; i < negotiableBaudRatesAmount; i++)
+            {
+                if (negotiableBaudRates[i] == rate) requestedBaud = rate;
+            }
+        }
+
+        token = strtok(NULL, ";");
     }
 
+    return requestedBaud;
+}
+
+
+/**
+ * Switches to a negotiated baud rate and verifies the link with a round trip. Switches back to baud if the client does not answer correctly. Returns success
+ */
+bool _switchBaudrate(uint32_t rate)
+{
+    printf("Switching to %u baud...\n", rate);
 
-    // Collect all valid ttyUSB* files
-    char usbPorts[32][16] = {};
-    int usbPortsFound = 0;
+    usleep(50000); // Give the client time to switch after sending its response
 
-    while ((ep = readdir(dp)) != NULL)
+    if (serialSetBaudrate(rate))
     {
-        // Ignore port if not an USB port
-        if (strstr(ep->d_name, "ttyUSB") == NULL) continue;
+        serialDiscardInput(); // Drop anything that was received while switching
+
+        char verifyStr[48];
+        snprintf(verifyStr, sizeof(verifyStr), "+ResourceMonitorLinuxServer?%u#", rate);
+
+        char expectedStr[48];
+        snprintf(expectedStr, sizeof(expectedStr), "%s?%u", serialClientHeader, rate);
+
+        char buffer[64] = "";
+
+        if (serialWrite(verifyStr, strlen(verifyStr))
+            && _readSerialIntoBuffer(buffer, sizeof(buffer), baudVerifyTimeout)
+            && strcmp(buffer, expectedStr) == 0)
+        {
+            return true;
+        }
+    }
+
+
+    // Fall back. The client switches back on its own if it does not receive our verification message in time, wait for it
+    printf("\033[33mWarn:\033[0m Link did not work at %u baud, falling back to %d baud...\n", rate, baud);
+
+    serialSetBaudrate(baud);
+    usleep(baudVerifyTimeout * 1000);
+    serialDiscardInput();
+
+    return false;
+}
 
-        char port[16] = "/dev/";
-        strncat(port, ep->d_name, sizeof(port) - 1);
 
-        strncpy(usbPorts[usbPortsFound], port, sizeof(port) - 1);
-        usbPortsFound++;
+/**
+ * Stops advertising the current baud rate and all faster ones
+ */
+void _lowerBaudLimit()
+{
+    for (uint32_t i = 0; i < negotiableBaudRatesAmount; i++)
+    {
+        if (negotiableBaudRates[i] == negotiatedBaud) baudLimit = i + 1;
     }
+}
+
 
-    (void) closedir(dp);
+/**
+ * Checks the handshake response a device sent. Stores the baud rate the client wants to switch to in requestedBaud. Returns true if it came from a compatible client
+ */
+bool _checkHandshakeResponse(const char *buffer, const char *port, uint32_t *requestedBaud)
+{
+    if (strstr(buffer, serialClientHeader) == NULL) // Response with invalid header
+    {
+        printf("\033[91mError:\033[0m Received invalid response from device '%s': %s\n", port, buffer);
+        return false;
+    }
 
-    if (usbPortsFound == 0)
+    // Check whether the received message is of type initial handshake
+    if (*(buffer + strlen(serialClientHeader)) != '-')
     {
-        printf("\033[91mError:\033[0m Found no devices! Exiting...\n");
-        exit(1);
+        printf("\033[91mError:\033[0m Received response from client on '%s' of invalid type: %s\n", port, buffer);
+        return false;
     }
 
-    printf("Found %d eligible device(s)!\n", usbPortsFound);
 
+    // Compare version
+    char versionStr[64] = ""; // Large enough for all capabilities the client echoes back
+
+    strncpy(versionStr, buffer + strlen(serialClientHeader) + 1, sizeof(versionStr) - 1); // Offset buffer by header content infront of message content
 
-    // Attempt to connect to all ports
-    for (int i = 0; i < usbPortsFound; i++)
+    // Split off capabilities the client appended to its version
+    *requestedBaud = _parseCapabilities(versionStr);
+
+    if (strcmp(versionStr, version) != 0)
     {
-        char *port = usbPorts[i];
+        printf("\033[91mError:\033[0m Version mismatch! Client on '%s' runs on %s but we are on %s!\n", port, versionStr, version);
+        return false;
+    }
+
+    return true;
+}
+
+
+// Persistent data for _probePorts()
+struct ProbeState {
+    uint32_t headersPending; // Headers sent since the client last started listening, it answers every one of them
+    bool     resetSent;
+    uint64_t lastHeaderTime; // CLOCK_MONOTONIC ms
+    uint64_t nextHeaderTime; // CLOCK_MONOTONIC ms
+};
+
+struct ProbeState probeStates[maxSerialProbes];
+
+/**
+ * Sends our header to a device and schedules the next attempt in case it does not respond. Returns success
+ */
+bool _sendProbeHeader(int probe, const char *headerStr, uint64_t now)
+{
+    struct ProbeState *state = &probeStates[probe];
+
+    state->headersPending++;
+    state->lastHeaderTime = now;
+    state->nextHeaderTime = now + headerRepeatInterval;
 
-        printf("Attempting to connect on port '%s', timeout is set to %dms...\n", port, config.arduinoReplyTimeout);
+    logDebug("_sendProbeHeader: Sending header '%s' to device '%s'", headerStr, serialProbeGetPort(probe));
 
+    return serialProbeWrite(probe, headerStr, strlen(headerStr));
+}
+
+
+/**
+ * Handshakes with the candidates from first to last concurrently. Returns the index of the first candidate which responded validly and makes it the connection, -1 if none did
+ */
+int _probePorts(const struct PortCandidate *candidates, int first, int last, char *buffer, size_t size, uint32_t *requestedBaud, uint32_t timeout)
+{
+    // Open all ports at once so that connecting takes as long as one handshake, no matter on which port the Arduino is
+    int probesOpen = 0;
+    int epollFd    = epoll_create1(EPOLL_CLOEXEC);
+
+    for (int i = first; i < last; i++)
+    {
+        printf("Attempting to connect on port '%s' (%s:%s, %s)...\n", candidates[i].path, candidates[i].vendorId, candidates[i].productId, portRankNames[candidates[i].rank]);
 
-        // Open a new connection with timeout set in config
-        if (!serialNewConnection(port, baud)) continue;
+        if (!serialProbeOpen(i, candidates[i].path, baud)) continue;
 
-        usleep(2500000); // Wait 2.5 seconds because the Arduino likes to reset for some reason
+        struct epoll_event event = { .events = EPOLLIN, .data.u32 = i };
 
-        if (!serialIsOpen())
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, serialProbeGetFd(i), &event) < 0)
         {
-            printf("\033[91mError:\033[0m Failed to connect to device '%s': Port did not open\n", port);
+            serialProbeClose(i);
             continue;
         }
 
-        logDebug("Opened connection to device '%s'! Attempting to handshake...", port);
+        probeStates[i] = (struct ProbeState) { .headersPending = 0, .resetSent = false, .lastHeaderTime = 0, .nextHeaderTime = 0 };
+        probesOpen++;
+    }
+
+    if (probesOpen == 0)
+    {
+        close(epollFd);
+        return -1;
+    }
+
+    printf("Waiting for a response from %d device(s). Timeout is set to %ums...\n", probesOpen, timeout);
+
 
+    // A header starts with a +, normal data with a ~
+    char headerStr[64] = "";
+    _buildHeader(headerStr, sizeof(headerStr));
 
-        // Attempt to send client our header. A header starts with a +, normal data with a ~
-        serialFlushOutput(); // Clear anything that may be buffered
 
-        char headerStr[64] = "+ResourceMonitorLinuxServer-";
-        strcat(headerStr, version);
-        strcat(headerStr, "#"); // strcat null terminates here because "#" is a null terminated string
+    // Send our header right away instead of waiting for the Arduino to boot. If opening the port reset it, the client announces its reboot and we send our header again
+    int      winner   = -1;
+    uint64_t deadline = getMonotonicMs() + timeout;
 
-        if (!serialWrite(headerStr, strlen(headerStr)))
+    while (winner < 0 && probesOpen > 0)
+    {
+        uint64_t now = getMonotonicMs();
+
+        if (now >= deadline) break;
+
+        uint64_t wakeTime = deadline;
+
+        for (int i = first; i < last; i++)
         {
-            serialClose();
-            continue;
+            if (serialProbeGetFd(i) < 0) continue;
+
+            if (now >= probeStates[i].nextHeaderTime)
+            {
+                // A client which did not reset since it negotiated a faster rate with a previous connection cannot read our header. Reset our Arduino once, it announces its reboot.
+                // Devices we are not sure about just get our header again
+                if (probeStates[i].headersPending > 0 && !probeStates[i].resetSent && config.keepDtr && candidates[i].rank == PORT_RANK_PREFERRED)
+                {
+                    printf("No response from '%s', resetting it...\n", serialProbeGetPort(i));
+
+                    probeStates[i].resetSent = true;
+
+                    if (serialProbeResetDevice(i))
+                    {
+                        probeStates[i].headersPending = 0;
+                        probeStates[i].nextHeaderTime = now + headerRepeatInterval;
+
+                        if (now + timeout > deadline) deadline = now + timeout; // Give it the full timeout to boot and answer
+                    }
+                }
+
+                if (now >= probeStates[i].nextHeaderTime && !_sendProbeHeader(i, headerStr, now))
+                {
+                    serialProbeClose(i);
+                    probesOpen--;
+                    continue;
+                }
+            }
+
+            if (probeStates[i].nextHeaderTime < wakeTime) wakeTime = probeStates[i].nextHeaderTime;
         }
 
-        logDebug("Sent header '%s' to device '%s'! Listening for response...", headerStr, port);
-
+        struct epoll_event events[maxSerialProbes];
 
-        // Attempt to listen for a response
-        char buffer[64] = "";
+        int eventsAmount = epoll_wait(epollFd, events, maxSerialProbes, (wakeTime > now) ? wakeTime - now : 0);
 
-        bool readSuccess = _readSerialIntoBuffer(buffer, sizeof buffer, config.arduinoReplyTimeout);
+        if (eventsAmount < 0 && errno != EINTR) break;
 
-        if (!readSuccess)
+        for (int i = 0; i < eventsAmount && winner < 0; i++)
         {
-            printf("\033[91mError:\033[0m Received no or invalid response from client: %s\n", buffer);
-            serialClose();
-            continue;
+            int probe = events[i].data.u32;
+
+            while (serialProbeGetFd(probe) >= 0)
+            {
+                enum SerialMessageResult result = serialProbeReadMessage(probe, buffer, size, 0);
+
+                if (result == SERIAL_MESSAGE_GARBAGE) continue; // E.g. bytes sent while booting
+                if (result == SERIAL_MESSAGE_NONE) break;       // Response is not complete yet
+
+                if (result == SERIAL_MESSAGE_ERROR) // Closing its fd also removes it from epoll
+                {
+                    serialProbeClose(probe);
+                    probesOpen--;
+                    break;
+                }
+
+                const char *message = strstr(buffer, serialClientHeader);
+
+                if (message == NULL) // Not our client
+                {
+                    logDebug("_probePorts: Ignoring message from device '%s': %s", serialProbeGetPort(probe), buffer);
+                    continue;
+                }
+
+                char type = message[strlen(serialClientHeader)];
+
+                if (type == '-') // Handshake response
+                {
+                    if (_checkHandshakeResponse(message, serialProbeGetPort(probe), requestedBaud))
+                    {
+                        winner = probe;
+                        break;
+                    }
+
+                    serialProbeClose(probe);
+                    probesOpen--;
+                    break;
+                }
+
+                if (type == '*') // Interrupt, the client rebooted or fell back to baud. Either way it forgot every header we sent and listens at baud now
+                {
+                    printf("Client on '%s' %s, sending header again...\n", serialProbeGetPort(probe), (strcmp(message + strlen(serialClientHeader) + 1, "DEVICE_RESET") == 0) ? "rebooted" : "fell back to baud");
+
+                    uint64_t rebootTime = getMonotonicMs();
+
+                    probeStates[probe].headersPending = 0;
+
+                    if (!_sendProbeHeader(probe, headerStr, rebootTime))
+                    {
+                        serialProbeClose(probe);
+                        probesOpen--;
+                        break;
+                    }
+
+                    if (rebootTime + timeout > deadline) deadline = rebootTime + timeout; // Give it the full timeout to answer, booting may have taken most of it
+
+                    continue;
+                }
+
+                // Anything else, e.g. credits of a client which still thinks it is connected to a previous connection. It answers our next header
+            }
         }
+    }
+
+    close(epollFd);
+
+
+    // Keep the winner and close all other ports
+    for (int i = first; i < last; i++)
+    {
+        if (i != winner) serialProbeClose(i);
+    }
+
+    if (winner < 0) return -1;
+
+    serialProbeSelect(winner);
+
+
+    // The client answers every header it received. Let it work through one we repeated before switching rates, it would otherwise read it as garbage at the new rate and miss our verification
+    uint64_t now        = getMonotonicMs();
+    uint64_t parsedTime = probeStates[winner].lastHeaderTime + headerParseTime;
+
+    if (probeStates[winner].headersPending > 1 && parsedTime > now)
+    {
+        logDebug("_probePorts: Waiting %" PRIu64 "ms for the client to answer our repeated header", parsedTime - now);
+
+        usleep((parsedTime - now) * 1000);
+        serialDiscardInput();
+    }
+
+    return winner;
+}
+
+
+/**
+ * Attempts to find and connect to Arduino over Serial
+ */
+void makeConnection()
+{
+    char     buffer[64]    = "";
+    uint32_t requestedBaud = baud;
+
+    struct PortCandidate  candidates[maxSerialProbes];
+    struct PortCandidate *connected = NULL;
+
+
+    // Try the port we were last connected to on its own before scanning, most of the time the Arduino is still there
+    struct PortCandidate lastCandidate;
+
+    bool lastPortTried = getLastPort(&lastCandidate, lastPortWaitTimeout);
+
+    if (lastPortTried)
+    {
+        printf("Trying last used port '%s' first...\n", lastCandidate.path);
+
+        if (_probePorts(&lastCandidate, 0, 1, buffer, sizeof(buffer), &requestedBaud, lastPortReplyTimeout) == 0) connected = &lastCandidate;
+    }
+
+
+    if (connected == NULL)
+    {
+        // Get all USB serial ports, most likely ones first
+        int candidatesFound = buildPortIndex(candidates, maxSerialProbes);
 
-        // Check whether the received message is of type initial handshake
-        if (*(buffer + strlen(serialClientHeader)) != '-')
+        if (candidatesFound == 0 && !lastPortTried)
         {
-            printf("\033[91mError:\033[0m Received response from client of invalid type: %s\n", buffer);
-            serialClose();
-            continue;
+            printf("\033[91mError:\033[0m Found no devices! Exiting...\n");
+            exit(1);
         }
 
+        // Don't wait for the last used port again
+        for (int i = 0; lastPortTried && i < candidatesFound; i++)
+        {
+            if (strcmp(candidates[i].path, lastCandidate.path) != 0) continue;
 
-        // Compare version
-        char versionStr[16] = "";
+            memmove(&candidates[i], &candidates[i + 1], (candidatesFound - i - 1) * sizeof(candidates[0]));
+            candidatesFound--;
+            break;
+        }
 
-        strncpy(versionStr, buffer + strlen(serialClientHeader) + 1, sizeof(versionStr) - 1); // Offset buffer by header content infront of message content
-        versionStr[strlen(versionStr) - 1] = '\0'; // Remove last char which is the end char #
+        printf("Found %d eligible device(s)!\n", candidatesFound);
 
-        if (strcmp(versionStr, version) != 0)
+
+        // Probe one rank at a time so that unrelated serial devices are only poked at if none of the likely ones answered
+        for (int first = 0; first < candidatesFound && connected == NULL; )
         {
-            printf("\033[91mError:\033[0m Version mismatch! Client runs on %s but we are on %s!\n", versionStr, version);
-            serialClose();
-            continue;
+            int last = first;
+
+            while (last < candidatesFound && candidates[last].rank == candidates[first].rank) last++;
+
+            int winner = _probePorts(candidates, first, last, buffer, sizeof(buffer), &requestedBaud, config.arduinoReplyTimeout);
+
+            if (winner >= 0) connected = &candidates[winner];
+                else if (last < candidatesFound) printf("\033[33mWarn:\033[0m No valid response from %s devices, trying the remaining ones...\n", portRankNames[candidates[first].rank]);
+
+            first = last;
         }
+    }
 
+    if (connected == NULL)
+    {
+        printf("\033[91mError:\033[0m Received no valid response from any device!\n");
+        return;
+    }
 
-        logDebug("Received valid response from client: %s", buffer);
-        break;
+    rememberPort(connected);
+
+
+    logDebug("Received valid response from client on port '%s': %s", serialGetPort(), buffer);
+
+    printf("Client supports %s protocol%s%s.\n", negotiatedProtocol == PROTOCOL_FRAME ? "binary frame" : "text", creditFlowControl ? " with flow control" : "", snapshotSupported ? " and snapshots" : "");
+
+
+    // Switch to a faster baud rate if the client supports one
+    negotiatedBaud = baud;
+    linkErrors     = 0;
+
+    resetLinkStats();
+    requestSnapshot(); // Measures the time until the client displays everything from here on
+
+    if (requestedBaud != baud)
+    {
+        if (_switchBaudrate(requestedBaud)) negotiatedBaud = requestedBaud;
+            else _lowerBaudLimit();
     }
 }
 
 
 /**
- * Checks whether client sent an interrupt message and handle it
+ * Counts a corrupted message received from the client. Reconnects at a slower baud rate if linkErrorThreshold is reached. Returns true if a reconnect happened
+ */
+bool _handleLinkError()
+{
+    if (negotiatedBaud == baud) return false; // Nothing slower to fall back to
+
+    linkErrors++;
+
+    if (linkErrors < linkErrorThreshold) return false;
+
+    printf("\033[33mWarn:\033[0m Received %u corrupted messages at %u baud, reconnecting at a slower rate...\n", linkErrors, negotiatedBaud);
+
+    _lowerBaudLimit();
+    reconnect();
+
+    return true;
+}
+
+
+/**
+ * Interprets a complete message received from the client outside of the handshake. Returns true if a reconnect happened
  */
-void checkForClientInterrupt()
+bool _handleClientMessage(const char *buffer)
 {
-    // Attempt to read into buffer
-    char buffer[64] = "";
+    if (strstr(buffer, serialClientHeader) == NULL) // Message with invalid header
+    {
+        printf("\033[91mError:\033[0m Received invalid message from client: %s\n", buffer);
+        return _handleLinkError();
+    }
 
-    logDebug("checkForClientInterrupt: Checking for interrupt...");
-    bool readSuccess = _readSerialIntoBuffer(buffer, sizeof buffer, 500);
+    linkErrors = 0; // Only count errors in a row, like the client does. Isolated glitches hours apart should not lower the rate
 
-    if (!readSuccess)
+    // Credit granted after the client processed a message
+    if (*(buffer + strlen(serialClientHeader)) == '!')
     {
-        return;
+        addCredits(atoi(buffer + strlen(serialClientHeader) + 1));
+        return false;
+    }
+
+    // Client painted the snapshot we sent
+    if (*(buffer + strlen(serialClientHeader)) == '=')
+    {
+        snapshotAcknowledged();
+        return false;
     }
 
     if (*(buffer + strlen(serialClientHeader)) != '*')
     {
         printf("\033[91mError:\033[0m Received interrupt message from client of invalid type: %s\n", buffer);
-        return;
+        return false;
     }
 
 
     // Interpret the response
-    logDebug("checkForClientInterrupt: Received message: %s", buffer);
+    logDebug("_handleClientMessage: Received message: %s", buffer);
 
     char interruptStr[16] = "";
 
     strncpy(interruptStr, buffer + strlen(serialClientHeader) + 1, sizeof(interruptStr) - 1); // Offset buffer by header content infront of message content
-    interruptStr[strlen(interruptStr) - 1] = '\0'; // Remove last char which is the end char #
 
     if (strcmp(interruptStr, "DEVICE_RESET") == 0) // TODO: Switch to numbered message type enum system? Like the arduino does for comparing measurement type
     {
+        if (negotiatedBaud != baud) // The client is back at baud, handshake with it again to negotiate our rate
+        {
+            printf("Received 'RESET' interrupt message from Arduino, reconnecting to negotiate %u baud again...\n", negotiatedBaud);
+            reconnect();
+            return true;
+        }
+
         printf("Received 'RESET' interrupt message from Arduino, clearing local measurement cache...\n");
         resetCache();
-        return;
+        resetFlowControl(false); // The client forgot everything we negotiated
+        requestSnapshot();
+        return false;
+    }
+
+    if (strcmp(interruptStr, "BAUD_FALLBACK") == 0) // Client received too many corrupted messages
+    {
+        linkErrors = linkErrorThreshold - 1;
+        return _handleLinkError();
+    }
+
+    return false;
+}
+
+
+/**
+ * Handles every complete message the client sent without blocking. Call when the serial port is readable
+ */
+void handleClientMessages()
+{
+    char buffer[64];
+
+    while (true)
+    {
+        enum SerialMessageResult result = serialReadMessage(buffer, sizeof(buffer), 0);
+
+        if (result == SERIAL_MESSAGE_NONE || result == SERIAL_MESSAGE_ERROR) return;
+
+        if (result == SERIAL_MESSAGE_GARBAGE)
+        {
+            logDebug("handleClientMessages: Dropping corrupted message");
+
+            if (_handleLinkError()) return;
+            continue;
+        }
+
+        if (_handleClientMessage(buffer)) return; // Reconnected
     }
 }
@@ -0,0 +1,334 @@
+/*
+ * File: portIndex.c
+ * Project: arduino-resource-monitor
+ * Created Date: 2026-10-18 05:41:27
+ * Author: 3urobeat
+ *
+ * Last Modified: 2026-10-18 10:19:50
+ * Modified By: 3urobeat
+ *
+ * Copyright (c) 2026 3urobeat <https://github.com/3urobeat>
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "comm.h"
+
+#include <dirent.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+
+// USB IDs of Arduinos and the USB-serial chips commonly found on them and their clones. productId NULL matches every product of the vendor
+const struct {
+    const char *vendorId;
+    const char *productId;
+} knownUsbIds[] = {
+    { "2341", NULL },   // Arduino
+    { "2a03", NULL },   // Arduino.org
+    { "1a86", "7523" }, // CH340
+    { "1a86", "5523" }, // CH341
+    { "0403", "6001" }, // FTDI FT232R
+    { "0403", "6015" }, // FTDI FT231X
+    { "10c4", "ea60" }  // Silicon Labs CP210x
+};
+
+#define knownUsbIdsAmount (sizeof(knownUsbIds) / sizeof(knownUsbIds[0]))
+
+const char *portRankNames[] = { "preferred", "known adapter", "unknown" };
+
+
+// Persistent data for rememberPort() & getLastPort(). Identifies the device we were last connected to, survives restarts in lastPortFile
+#define lastPortFile "lastPort"
+
+struct PortCandidate lastPort;
+bool lastPortSet       = false;
+bool lastPortLoaded    = false;
+bool lastPortConnected = false; // True if we connected to it since starting and it did not stay gone for longer than a wait in getLastPort() since
+
+
+/**
+ * Reads a sysfs attribute of a USB device into dest. Leaves dest empty if the device does not have it
+ */
+void _readUsbAttribute(char *dest, int size, const char *deviceDir, const char *name)
+{
+    char path[PATH_MAX];
+
+    dest[0] = '\0';
+
+    if (snprintf(path, sizeof(path), "%s/%s", deviceDir, name) >= (int) sizeof(path)) return;
+
+    if (access(path, R_OK) != 0) return;
+
+    getFileContent(dest, size, path, '\n');
+}
+
+
+/**
+ * Finds the sysfs directory of the USB device a tty belongs to. ttyACM devices sit one level below it (interface), ttyUSB devices two (interface & usb-serial port). Returns success
+ */
+bool _findUsbDevice(char *dest, const char *ttyName)
+{
+    char path[PATH_MAX];
+
+    if (snprintf(path, sizeof(path), "/sys/class/tty/%s/device", ttyName) >= (int) sizeof(path)) return false;
+
+    if (realpath(path, dest) == NULL) return false;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (snprintf(path, sizeof(path), "%s/idVendor", dest) >= (int) sizeof(path)) return false;
+
+        if (access(path, R_OK) == 0) return true;
+
+        char *parent = strrchr(dest, '/');
+
+        if (parent == NULL || parent == dest) return false;
+
+        *parent = '\0';
+    }
+
+    return false;
+}
+
+
+/**
+ * Reads the USB identity of a tty into candidate. Returns false if the tty does not belong to a USB device
+ */
+bool _readPortIdentity(struct PortCandidate *candidate, const char *ttyName)
+{
+    char deviceDir[PATH_MAX];
+
+    candidate->vendorId[0]  = '\0';
+    candidate->productId[0] = '\0';
+    candidate->serial[0]    = '\0';
+
+    if (!_findUsbDevice(deviceDir, ttyName)) return false;
+
+    _readUsbAttribute(candidate->vendorId, sizeof(candidate->vendorId), deviceDir, "idVendor");
+    _readUsbAttribute(candidate->productId, sizeof(candidate->productId), deviceDir, "idProduct");
+    _readUsbAttribute(candidate->serial, sizeof(candidate->serial), deviceDir, "serial");
+
+    return true;
+}
+
+
+/**
+ * Loads the device we were last connected to from the config directory, if we have been connected before
+ */
+void _loadLastPort()
+{
+    lastPortLoaded = true;
+
+    if (getConfigDirPath()[0] == '\0') return; // Config was not imported yet, the path would be relative to the working directory
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s%s", getConfigDirPath(), lastPortFile);
+
+    FILE *filePtr = fopen(path, "r");
+
+    if (!filePtr) return; // Never connected before
+
+    // One value per line: path, vendorId, productId & serial
+    char *fields[] = { lastPort.path, lastPort.vendorId, lastPort.productId, lastPort.serial };
+    int   sizes[]  = { sizeof(lastPort.path), sizeof(lastPort.vendorId), sizeof(lastPort.productId), sizeof(lastPort.serial) };
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (fgets(fields[i], sizes[i], filePtr) == NULL) fields[i][0] = '\0';
+
+        fields[i][strcspn(fields[i], "\n")] = '\0';
+    }
+
+    (void) fclose(filePtr);
+
+    lastPortSet = (strncmp(lastPort.path, "/dev/", 5) == 0);
+
+    logDebug("_loadLastPort: Last connected to '%s' (%s:%s, serial '%s')", lastPort.path, lastPort.vendorId, lastPort.productId, lastPort.serial);
+}
+
+
+/**
+ * Writes the device we were last connected to into the config directory
+ */
+void _saveLastPort()
+{
+    if (getConfigDirPath()[0] == '\0') return;
+
+    mkdir(getConfigDirPath(), 0700); // Fails if it already exists, which is fine
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s%s", getConfigDirPath(), lastPortFile);
+
+    errno = 0;
+    FILE *filePtr = fopen(path, "w");
+
+    if (!filePtr)
+    {
+        printf("\033[33mWarn:\033[0m Failed to save last used port to '%s'! Error: %s\n", path, strerror(errno));
+        return;
+    }
+
+    fprintf(filePtr, "%s\n%s\n%s\n%s\n", lastPort.path, lastPort.vendorId, lastPort.productId, lastPort.serial);
+
+    (void) fclose(filePtr);
+}
+
+
+/**
+ * Returns true if a candidate is the device we were last connected to. Adapters without a serial number are recognized by their port instead
+ */
+bool _isLastPort(const struct PortCandidate *candidate)
+{
+    if (!lastPortSet) return false;
+
+    if (strcmp(candidate->vendorId, lastPort.vendorId) != 0 || strcmp(candidate->productId, lastPort.productId) != 0) return false;
+
+    if (lastPort.serial[0] != '\0') return strcmp(candidate->serial, lastPort.serial) == 0;
+
+    return strcmp(candidate->path, lastPort.path) == 0;
+}
+
+
+/**
+ * Ranks a candidate by how likely it is our client
+ */
+enum PortRank _rankCandidate(const struct PortCandidate *candidate)
+{
+    if (config.serialNumber[0] != '\0' && strcmp(candidate->serial, config.serialNumber) == 0) return PORT_RANK_PREFERRED;
+
+    if (_isLastPort(candidate)) return PORT_RANK_PREFERRED;
+
+    for (uint32_t i = 0; i < knownUsbIdsAmount; i++)
+    {
+        if (strcmp(candidate->vendorId, knownUsbIds[i].vendorId) != 0) continue;
+
+        if (knownUsbIds[i].productId == NULL || strcmp(candidate->productId, knownUsbIds[i].productId) == 0) return PORT_RANK_KNOWN;
+    }
+
+    return PORT_RANK_OTHER;
+}
+
+
+/**
+ * Collects all USB serial ports (ttyUSB & ttyACM) into dest, sorted by rank. Returns the amount of ports found
+ */
+int buildPortIndex(struct PortCandidate *dest, int size)
+{
+    if (!lastPortLoaded) _loadLastPort();
+
+    DIR *dp = opendir("/sys/class/tty/");
+
+    if (dp == NULL)
+    {
+        printf("\033[91mError:\033[0m Failed to open '/sys/class/tty/' to find all used USB ports!\n");
+        return 0;
+    }
+
+
+    // Collect all ports that belong to a USB device
+    struct dirent *ep;
+    int found = 0;
+
+    while ((ep = readdir(dp)) != NULL && found < size)
+    {
+        if (strncmp(ep->d_name, "ttyUSB", 6) != 0 && strncmp(ep->d_name, "ttyACM", 6) != 0) continue;
+
+        struct PortCandidate *candidate = &dest[found];
+
+        memset(candidate, 0, sizeof(*candidate));
+
+        if (snprintf(candidate->path, sizeof(candidate->path), "/dev/%s", ep->d_name) >= (int) sizeof(candidate->path)) // Opening a truncated path would hit another port
+        {
+            logDebug("buildPortIndex: Skipping '%s', its name is too long", ep->d_name);
+            continue;
+        }
+
+        _readPortIdentity(candidate, ep->d_name);
+
+        candidate->rank = _rankCandidate(candidate);
+
+        logDebug("buildPortIndex: Found '%s' (%s:%s, serial '%s'), rank %s", candidate->path, candidate->vendorId, candidate->productId, candidate->serial, portRankNames[candidate->rank]);
+
+        found++;
+    }
+
+    (void) closedir(dp);
+
+
+    // Sort by rank. Insertion sort keeps the directory order within a rank and we never have more than a handful of ports
+    for (int i = 1; i < found; i++)
+    {
+        struct PortCandidate current = dest[i];
+
+        int pos = i;
+
+        while (pos > 0 && dest[pos - 1].rank > current.rank)
+        {
+            dest[pos] = dest[pos - 1];
+            pos--;
+        }
+
+        dest[pos] = current;
+    }
+
+    return found;
+}
+
+
+/**
+ * Remembers the device we connected to so that it is probed first, and alone, on the next reconnect or start
+ */
+void rememberPort(const struct PortCandidate *candidate)
+{
+    bool changed = !_isLastPort(candidate) || strcmp(candidate->path, lastPort.path) != 0;
+
+    lastPort          = *candidate;
+    lastPortSet       = true;
+    lastPortLoaded    = true;
+    lastPortConnected = true;
+
+    if (changed) _saveLastPort();
+}
+
+
+/**
+ * Gets the device we were last connected to if it is still present. If it vanished while we were connected to it, waits up to timeout ms for it to re-appear,
+ * e.g. while it re-enumerates after a reset or USB hiccup. A port remembered from a previous run, or one that did not re-appear in time before, is only checked once.
+ * Returns false if we were never connected, it did not re-appear or another device took its port
+ */
+bool getLastPort(struct PortCandidate *dest, uint32_t timeout)
+{
+    if (!lastPortLoaded) _loadLastPort();
+
+    if (!lastPortSet) return false;
+
+    const char *ttyName  = strrchr(lastPort.path, '/') + 1;
+    uint64_t    deadline = getMonotonicMs() + (lastPortConnected ? timeout : 0);
+
+    while (true)
+    {
+        struct PortCandidate current = lastPort;
+
+        if (access(lastPort.path, F_OK) == 0 && _readPortIdentity(&current, ttyName))
+        {
+            if (!_isLastPort(&current)) return false;
+
+            current.rank = PORT_RANK_PREFERRED;
+            *dest        = current;
+
+            return true;
+        }
+
+        if (getMonotonicMs() >= deadline)
+        {
+            lastPortConnected = false; // Don't wait for it again on every retry, it was probably unplugged or moved to another port
+            return false;
+        }
+
+        usleep(100000);
+    }
+}
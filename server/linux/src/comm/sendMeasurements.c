@@ -4,10 +4,10 @@
  * Created Date: 2023-01-24 17:41:01
  * Author: 3urobeat
  *
- * Last Modified: 2025-12-22 15:38:05
+ * Last Modified: 2026-10-18 09:31:52
  * Modified By: 3urobeat
  *
- * Copyright (c) 2023 - 2025 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2023 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -17,24 +17,219 @@
 
 #include "comm.h"
 
+#include <inttypes.h>
 
-// Specifies the IDs (min 0, max 9) which data messages are prefixed with to indicate their type
-typedef enum {
-    pingID      = 0, // Empty data message only used by server for preventing connection loss screen
-    cpuLoadID   = 1,
-    cpuTempID   = 2,
-    ramUsageID  = 3,
-    swapUsageID = 4,
-    gpuLoadID   = 5,
-    gpuTempID   = 6
-} MeasurementPrefixIDsType;
 
-
-// Create storage for caching what we last sent to the Arduino to avoid unnecessary refreshes
-struct MeasurementTypes arduinoCache;
+// Create storage for caching what we last sent to the Arduino to avoid unnecessary refreshes. Indexed like metricRegistry
+char arduinoCache[MEASUREMENT_COUNT][dataSize];
 
 // Track time to decide if we have to send an alive ping so the Arduino doesn't display the 'Lost Connection!' screen
-clock_t lastWriteTime = 0;
+uint64_t lastWriteTime = 0; // CLOCK_MONOTONIC ms
+
+
+// Persistent data for _canWrite(). Every message costs one credit, the client grants one back after processing it
+bool     creditFlowControl = false;
+uint32_t credits           = 0;
+uint64_t stallStart        = 0; // CLOCK_MONOTONIC ms since which queued messages wait for a credit, 0 if not stalled
+
+uint64_t inFlightTimes[creditWindow]; // CLOCK_MONOTONIC ms at which every message the client did not grant a credit for yet was written, oldest first
+uint32_t inFlightAmount       = 0;
+bool     outputQueued         = false; // True until the kernel transmitted the last message we wrote
+bool     outputQueueSupported = true;  // False if the driver cannot report its output queue (TIOCOUTQ), writes are then not paced by it
+
+struct LinkStats linkStats;
+
+
+/**
+ * Adds a sample to latency statistics
+ */
+void _recordLatency(struct LatencyStats *stats, uint64_t ms)
+{
+    stats->count++;
+    stats->sumMs += ms;
+
+    if (ms > stats->maxMs) stats->maxMs = ms;
+}
+
+
+/**
+ * Adds credits granted by the client
+ */
+void addCredits(uint32_t amount)
+{
+    uint64_t now = getMonotonicMs();
+
+    // Every credit acknowledges our oldest message in flight
+    for (uint32_t i = 0; i < amount && inFlightAmount > 0; i++)
+    {
+        _recordLatency(&linkStats.creditLatency, now - inFlightTimes[0]);
+
+        inFlightAmount--;
+        memmove(inFlightTimes, inFlightTimes + 1, inFlightAmount * sizeof(inFlightTimes[0]));
+    }
+
+    credits += amount;
+
+    if (credits > creditWindow) credits = creditWindow; // Never trust the client to allow more than its buffer fits
+}
+
+
+/**
+ * Resets flow control. Credit flow control is used if the client supports it, fixed pacing otherwise
+ */
+void resetFlowControl(bool useCredits)
+{
+    creditFlowControl = useCredits;
+    credits           = creditWindow;
+    stallStart        = 0;
+    inFlightAmount    = 0;
+    outputQueued      = false;
+
+    outputQueueSupported = true; // Might be another adapter after reconnecting
+}
+
+
+/**
+ * Resets the statistics printed by linkPrintStats(). Call after connecting
+ */
+void resetLinkStats()
+{
+    memset(&linkStats, 0, sizeof(linkStats));
+    linkStats.connectedSince = getMonotonicMs();
+}
+
+
+/**
+ * Returns the amount of bytes of the last message the kernel did not transmit yet and records how long transmitting took once it is done
+ */
+int _getOutputWaiting(uint64_t now)
+{
+    if (!outputQueued || !outputQueueSupported) return 0;
+
+    int waiting = serialOutputWaiting();
+
+    if (waiting > 0) return waiting;
+
+    if (waiting < 0) // Driver is unable to tell us. Don't wait for it and don't record a latency we never measured
+    {
+        logDebug("_getOutputWaiting: Driver does not report its output queue, disabling write pacing");
+
+        outputQueueSupported = false;
+        outputQueued         = false;
+        return 0;
+    }
+
+    // Everything was transmitted
+    _recordLatency(&linkStats.transmitLatency, now - lastWriteTime);
+
+    outputQueued = false;
+
+    return 0;
+}
+
+
+/**
+ * Returns how long the link needs to transmit an amount of bytes at the negotiated baud rate, using 10 bits per byte (8N1)
+ */
+uint64_t _getTransmitMs(int bytes)
+{
+    return (uint64_t) bytes * 10 * 1000 / negotiatedBaud;
+}
+
+
+/**
+ * Returns true if the client is able to receive another message right now. Never blocks, flushSendQueue() runs again when a credit arrives or the send timer expires
+ */
+bool _canWrite(uint64_t now)
+{
+    // Don't pile messages up in the kernel's output buffer. Measurements waiting in our queue can still be replaced by newer values, written ones can't
+    if (_getOutputWaiting(now) > 0) return false;
+
+    // Clients without flow control need a fixed delay to process the previous message, cutie is a little sloow
+    if (!creditFlowControl) return now - lastWriteTime >= legacySendDelay;
+
+    if (credits == 0 && now - lastWriteTime >= creditTimeout) // Credit got lost, e.g. because the message was corrupted. Continue instead of stalling forever
+    {
+        printf("\033[33mWarn:\033[0m Client did not grant a credit within %dms, continuing...\n", creditTimeout);
+
+        linkStats.creditTimeouts++;
+        credits        = creditWindow;
+        inFlightAmount = 0;
+    }
+
+    return credits > 0;
+}
+
+
+/**
+ * Writes a message to the client, taking one credit. Check _canWrite() first. Reconnects and returns false on failure
+ */
+bool _writeMessage(const char *data, size_t size)
+{
+    if (!serialWrite(data, size))
+    {
+        reconnect();
+        return false;
+    }
+
+    lastWriteTime = getMonotonicMs();
+    outputQueued  = outputQueueSupported;
+
+    if (credits > 0)
+    {
+        credits--;
+
+        if (creditFlowControl && inFlightAmount < creditWindow) inFlightTimes[inFlightAmount++] = lastWriteTime;
+    }
+
+    linkStats.messagesWritten++;
+    linkStats.bytesWritten += size;
+
+    if (stallStart != 0) // A credit arrived, stop measuring the stall
+    {
+        linkStats.stallMs += lastWriteTime - stallStart;
+        stallStart = 0;
+    }
+
+    return true;
+}
+
+
+/**
+ * Prints throughput and flow control statistics of the current connection to stdout
+ */
+void linkPrintStats()
+{
+    double seconds = (getMonotonicMs() - linkStats.connectedSince) / 1000.0;
+
+    if (linkStats.connectedSince == 0 || seconds <= 0) return;
+
+    printf("Link: %" PRIu64 " messages, %" PRIu64 " bytes (%.1f B/s), %" PRIu64 " stalls waiting %" PRIu64 "ms for credits, %" PRIu64 " credit timeouts\n",
+           linkStats.messagesWritten,
+           linkStats.bytesWritten,
+           linkStats.bytesWritten / seconds,
+           linkStats.stalls,
+           linkStats.stallMs,
+           linkStats.creditTimeouts);
+
+    if (linkStats.transmitLatency.count > 0)
+    {
+        printf("Link: Write latency %.1fms avg, %" PRIu64 "ms max until transmitted",
+               (double) linkStats.transmitLatency.sumMs / linkStats.transmitLatency.count,
+               linkStats.transmitLatency.maxMs);
+
+        if (linkStats.creditLatency.count > 0)
+        {
+            printf(", %.1fms avg, %" PRIu64 "ms max until processed by the client",
+                   (double) linkStats.creditLatency.sumMs / linkStats.creditLatency.count,
+                   linkStats.creditLatency.maxMs);
+        }
+
+        printf("\n");
+    }
+
+    if (linkStats.paintMs > 0) printf("Link: Client displayed all measurements %" PRIu64 "ms after handshake, %" PRIu64 " snapshots sent\n", linkStats.paintMs, linkStats.snapshotsSent);
+}
 
 
 char sendTempStr[32];
@@ -44,78 +239,455 @@ char sendTempStr[32];
  */
 void _sendSerial(const char *str, MeasurementPrefixIDsType id)
 {
-    memset(sendTempStr, '\0', sizeof(sendTempStr));
+    // Construct string to send: Data prefix, ID in decimal, separator, content & end delimiter. IDs below 10 keep the original single digit format
+    snprintf(sendTempStr, sizeof(sendTempStr), "~%u-%.*s#\n", (unsigned int) id, dataSize, str);
+
+    // Send content (team yippee)
+    if (!_writeMessage(sendTempStr, strlen(sendTempStr))) return;
 
-    // Construct string to send
-    sendTempStr[0] = '~';      // Data prefix
-    sendTempStr[1] = id + '0'; // Simple hack to "convert" id to char. Only supports id <= 10 ofc
-    sendTempStr[2] = '-';      // Add a separator
+    logDebug("Sending (%d): %s", strlen(sendTempStr), sendTempStr)
+}
 
-    strncat(sendTempStr, str, sizeof(sendTempStr) - 5); // 5 because of prefix char, type char, separator, end delimiter and null byte
-    strcat(sendTempStr, "#\n");
 
-    // Delay sending message if necessary to give Arduino time to process previous message, cutie is a little sloow
-    const clock_t lastWriteDiff = clock() - lastWriteTime;
+// Persistent data for _exceedsDeadband(). Tracks what the client currently displays
+struct SentState {
+    int32_t  value;
+    bool     valid;
+    uint64_t time;  // CLOCK_MONOTONIC ms of the last update
+};
 
-    if (lastWriteDiff < 500)
+struct SentState sentStates[MEASUREMENT_COUNT];
+
+int32_t scaledDeadbands[MEASUREMENT_COUNT];
+bool    scaledDeadbandsInitialized = false;
+
+/**
+ * Returns the deadband of a measurement in the scale it is stored in. Converted once so that comparing never needs floats
+ */
+int32_t _getScaledDeadband(enum MeasurementIndex index)
+{
+    if (!scaledDeadbandsInitialized)
     {
-        logDebug("_sendSerial: Delaying sending message by %ims to give Arduino processing time", (500 - lastWriteDiff))
-        usleep((500 - lastWriteDiff) * 1000);
+        for (int i = 0; i < MEASUREMENT_COUNT; i++)
+        {
+            const struct MetricDescriptor *metric = &metricRegistry[i];
+
+            scaledDeadbands[i] = (metric->deadband == NULL) ? 0 : (int32_t) lroundf(*metric->deadband * metric->scale);
+        }
+
+        scaledDeadbandsInitialized = true;
     }
 
-    // Send content (team yippee)
-    if (!serialWrite(sendTempStr, strlen(sendTempStr)))
+    return scaledDeadbands[index];
+}
+
+
+/**
+ * Returns true if a measurement moved further than its deadband away from what the client displays.
+ * Smaller changes are only sent once they are older than maxStaleness, so the display is eventually accurate without redrawing for every wobble
+ */
+bool _exceedsDeadband(enum MeasurementIndex index, uint64_t now)
+{
+    const struct SentState   *sent        = &sentStates[index];
+    const struct Measurement *measurement = &measurements.m[index];
+
+    int32_t value = measurement->value;
+    bool    valid = measurement->valid;
+
+    if (valid != sent->valid) return true; // First value or sensor was lost
+    if (!valid) return false;
+
+    if (abs(value - sent->value) > _getScaledDeadband(index)) return true;
+
+    return value != sent->value && now - sent->time >= (uint64_t) config.deadbands.maxStaleness;
+}
+
+
+/**
+ * Remembers the current value of a measurement as displayed by the client
+ */
+void _markSent(enum MeasurementIndex index, uint64_t now)
+{
+    sentStates[index].value = measurements.m[index].value;
+    sentStates[index].valid = measurements.m[index].valid;
+    sentStates[index].time  = now;
+}
+
+
+// Persistent data for _sendFrame()
+enum ProtocolType negotiatedProtocol = PROTOCOL_TEXT;
+
+#define frameMaxSize (4 + MEASUREMENT_COUNT * frameFieldSize)
+
+struct FrameCacheEntry { // What the client currently displays. Invalid entries are displayed as '/'
+    uint16_t value;
+    bool     valid;
+};
+
+struct FrameCacheEntry frameCache[MEASUREMENT_COUNT]; // Indexed like metricRegistry
+
+/**
+ * Sends all measurements that changed since the last frame in one binary frame. Sends an empty frame as alive ping if nothing changed for 5 secs.
+ * A snapshot contains every measurement regardless of what the client displays. Returns true if a frame was written
+ */
+bool _sendFrame(bool snapshot)
+{
+    uint8_t frame[frameMaxSize];
+    uint8_t length = 0;
+
+    uint8_t *payload = frame + 3;
+
+    struct FrameCacheEntry newCache[MEASUREMENT_COUNT];
+    bool                   included[MEASUREMENT_COUNT];
+
+    uint64_t now = getMonotonicMs();
+
+    // Add all fields which changed by more than their deadband
+    for (int i = 0; i < MEASUREMENT_COUNT; i++)
     {
-        reconnect();
-        return;
+        const struct MetricDescriptor *metric = &metricRegistry[i];
+
+        newCache[i] = frameCache[i];
+        included[i] = false;
+
+        if (metric->protocolId == pingID || (!snapshot && !_exceedsDeadband(i, now))) continue;
+
+        const struct Measurement *measurement = &measurements.m[i];
+
+        bool    valid = measurement->valid;
+        int64_t value = valid ? ((int64_t) measurement->value * metric->frameScale + measurement->scale / 2) / measurement->scale : 0; // Rescale with rounding
+
+        newCache[i].valid = valid;
+        newCache[i].value = (value <= 0) ? 0 : (value >= UINT16_MAX) ? UINT16_MAX : (uint16_t) value;
+
+        if (!snapshot && newCache[i].valid == frameCache[i].valid && newCache[i].value == frameCache[i].value) continue;
+
+        included[i] = true;
+
+        payload[length++] = metric->protocolId | (valid ? 0 : frameInvalidFlag);
+        payload[length++] = newCache[i].value & 0xFF;
+        payload[length++] = newCache[i].value >> 8;
     }
 
-    logDebug("Sending (%d): %s", strlen(sendTempStr), sendTempStr)
+    if (!snapshot && length == 0 && now - lastWriteTime < 5000) return false; // Nothing changed and no alive ping due
+
+    frame[0] = snapshot ? frameSnapshotStartByte : frameStartByte;
+    frame[1] = frameVersion;
+    frame[2] = length;
+    frame[3 + length] = crc8(frame + 1, length + 2);
+
+    logDebug("_sendFrame: Sending %s with %d field(s), %d bytes", snapshot ? "snapshot" : "frame", length / frameFieldSize, length + 4);
+
+    if (!_writeMessage((const char *) frame, length + 4)) return false;
+
+    memcpy(frameCache, newCache, sizeof(frameCache));
 
-    // Refresh lastWriteTime
-    lastWriteTime = clock();
+    for (int i = 0; i < MEASUREMENT_COUNT; i++)
+    {
+        if (included[i]) _markSent(i, now);
+    }
+
+    return true;
 }
 
 
+// Persistent data for requestSnapshot()
+bool     snapshotSupported = false;
+bool     snapshotRequested = false; // Send a snapshot with the next sendMeasurements() call
+bool     snapshotPending   = false; // Sent but not acknowledged yet
+uint64_t snapshotSentTime  = 0;
+uint64_t paintStartTime    = 0;     // Handshake or reset after which the client has to display everything again, 0 if it does
+
 /**
- * Send updated measurements to the Arduino
+ * Requests the whole state to be sent to the client as soon as we have measurements, e.g. after a handshake or reset. Starts measuring the time until the client displays everything
  */
-void sendMeasurements()
+void requestSnapshot()
+{
+    snapshotRequested = snapshotSupported && negotiatedProtocol == PROTOCOL_FRAME;
+    snapshotPending   = false;
+    paintStartTime    = getMonotonicMs();
+    linkStats.paintMs = 0;
+}
+
+
+/**
+ * Reports how long it took from the handshake or reset until the client displayed all measurements
+ */
+void _paintCompleted(const char *method)
+{
+    if (paintStartTime == 0) return;
+
+    linkStats.paintMs = getMonotonicMs() - paintStartTime;
+    paintStartTime    = 0;
+
+    printf("Client displays all measurements %" PRIu64 "ms after handshake (%s).\n", linkStats.paintMs, method);
+}
+
+
+/**
+ * Called when the client acknowledged that it painted the snapshot we sent
+ */
+void snapshotAcknowledged()
+{
+    if (!snapshotPending) return; // Duplicate or from before a reset
+
+    snapshotPending = false;
+
+    _paintCompleted("snapshot");
+}
+
+
+/**
+ * Returns true if at least one measurement has a value. Sending the whole state before the first snapshot was consumed would only paint placeholders
+ */
+bool _hasMeasurements()
+{
+    for (int i = 0; i < MEASUREMENT_COUNT; i++)
+    {
+        if (measurements.m[i].valid) return true;
+    }
+
+    return false;
+}
+
+
+/**
+ * Sends a snapshot if one was requested or the last one was not acknowledged in time. Returns true if the client will receive a snapshot
+ */
+bool _sendSnapshotIfDue()
+{
+    bool ackMissing = snapshotPending && getMonotonicMs() - snapshotSentTime >= snapshotAckTimeout;
+
+    if ((!snapshotRequested && !ackMissing) || !_hasMeasurements()) return false;
+
+    if (ackMissing)
+    {
+        logDebug("_sendSnapshotIfDue: Client did not acknowledge snapshot, resending it");
+    }
+
+    if (!_sendFrame(true)) return false;
+
+    snapshotRequested = false;
+    snapshotPending   = true;
+    snapshotSentTime  = getMonotonicMs();
+
+    linkStats.snapshotsSent++;
+
+    return true;
+}
+
+
+/**
+ * Checks if the client displays every measurement we have a value for since the last handshake or reset. Used for clients without snapshot support
+ */
+void _checkIncrementalPaint()
+{
+    if (paintStartTime == 0 || (snapshotSupported && negotiatedProtocol == PROTOCOL_FRAME) || !_hasMeasurements()) return;
+
+    for (int i = 0; i < MEASUREMENT_COUNT; i++)
+    {
+        if (metricRegistry[i].protocolId != pingID && measurements.m[i].valid && !sentStates[i].valid) return;
+    }
+
+    _paintCompleted("incremental");
+}
+
+
+/**
+ * Formats the latest value of a measurement and sends it using the text protocol if it differs from what the client displays
+ */
+void _sendTextMeasurement(enum MeasurementIndex index, uint64_t now)
+{
+    char str[dataSize];
+
+    formatMeasurement(str, sizeof(str), index, &measurements.m[index]);
+
+    if (strcmp(str, arduinoCache[index]) == 0) return;
+
+    _sendSerial(str, metricRegistry[index].protocolId);
+    strcpy(arduinoCache[index], str);
+    _markSent(index, now);
+}
+
+
+// Persistent data for flushSendQueue(). Queued measurements are read from measurements when they are sent, so a newer value always replaces a queued older one
+bool     queued[MEASUREMENT_COUNT];      // Used by the text protocol, indexed like metricRegistry
+uint64_t queuedSince[MEASUREMENT_COUNT]; // CLOCK_MONOTONIC ms. Kept when the value is replaced
+bool     framePending = false;           // Used by the frame protocol, which always sends all changes in one frame
+
+int sendTimerFd = -1;
+
+/**
+ * Returns the priority of a queued measurement. Alarming values go first, waiting entries slowly move up so that nothing starves
+ */
+int _getQueuePriority(enum MeasurementIndex index, uint64_t now)
 {
-    // Send what changed
-    if (strcmp(measurements.cpuLoad, arduinoCache.cpuLoad) != 0) {
-        _sendSerial(measurements.cpuLoad, cpuLoadID);
-        strcpy(arduinoCache.cpuLoad, measurements.cpuLoad);
+    const struct MetricDescriptor *metric      = &metricRegistry[index];
+    const struct Measurement      *measurement = &measurements.m[index];
+
+    if (metric->alarmThreshold > 0 && measurement->valid && measurement->value >= metric->alarmThreshold) return alarmPriority;
+
+    return metric->priority + (int) ((now - queuedSince[index]) / config.checkInterval);
+}
+
+
+/**
+ * Removes the queued measurement with the highest priority from the queue. Returns its index or -1 if the queue is empty
+ */
+int _dequeueNext(uint64_t now)
+{
+    int next         = -1;
+    int nextPriority = -1;
+
+    for (int i = 0; i < MEASUREMENT_COUNT; i++)
+    {
+        if (!queued[i]) continue;
+
+        int priority = _getQueuePriority(i, now);
+
+        if (priority > nextPriority) // Ties are sent in registry order
+        {
+            next         = i;
+            nextPriority = priority;
+        }
     }
 
-    if (strcmp(measurements.cpuTemp, arduinoCache.cpuTemp) != 0) {
-        _sendSerial(measurements.cpuTemp, cpuTempID);
-        strcpy(arduinoCache.cpuTemp, measurements.cpuTemp);
+    if (next >= 0) queued[next] = false;
+
+    return next;
+}
+
+
+/**
+ * Returns true if anything is waiting to be sent
+ */
+bool _hasQueuedWork()
+{
+    if (negotiatedProtocol == PROTOCOL_FRAME) return framePending;
+
+    for (int i = 0; i < MEASUREMENT_COUNT; i++)
+    {
+        if (queued[i]) return true;
     }
 
-    if (strcmp(measurements.ramUsage, arduinoCache.ramUsage) != 0) {
-        _sendSerial(measurements.ramUsage, ramUsageID);
-        strcpy(arduinoCache.ramUsage, measurements.ramUsage);
+    return false;
+}
+
+
+/**
+ * Arms the send timer to run flushSendQueue() again once the client should be able to receive the next message. Disarms it if nothing is queued or waiting to be transmitted
+ */
+void _armSendTimer(uint64_t now)
+{
+    if (sendTimerFd < 0) return;
+
+    uint64_t wakeIn = 0;
+
+    if (_hasQueuedWork())
+    {
+        uint64_t wakeAt = lastWriteTime + (creditFlowControl ? creditTimeout : legacySendDelay); // A granted credit wakes us up through the serial fd, the timer only catches lost credits
+
+        wakeIn = (wakeAt > now) ? wakeAt - now : 1;
     }
 
-    if (strcmp(measurements.swapUsage, arduinoCache.swapUsage) != 0) {
-        _sendSerial(measurements.swapUsage, swapUsageID);
-        strcpy(arduinoCache.swapUsage, measurements.swapUsage);
+    int waiting = _getOutputWaiting(now);
+
+    if (waiting > 0) // Wake up when the kernel should be done transmitting to measure its latency and continue sending
+    {
+        uint64_t transmitIn = _getTransmitMs(waiting) + 1;
+
+        if (wakeIn == 0 || transmitIn < wakeIn) wakeIn = transmitIn;
     }
 
-    if (strcmp(measurements.gpuLoad, arduinoCache.gpuLoad) != 0) {
-        _sendSerial(measurements.gpuLoad, gpuLoadID);
-        strcpy(arduinoCache.gpuLoad, measurements.gpuLoad);
+    struct itimerspec spec = { .it_value = { .tv_sec = wakeIn / 1000, .tv_nsec = (wakeIn % 1000) * 1000000 } };
+
+    timerfd_settime(sendTimerFd, 0, &spec, NULL);
+}
+
+
+/**
+ * Returns a timerfd which becomes readable when queued messages can be sent. Call flushSendQueue() then. Add it to your event loop
+ */
+int sendGetTimerFd()
+{
+    if (sendTimerFd < 0) sendTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    return sendTimerFd;
+}
+
+
+/**
+ * Sends queued messages for as long as the client is able to receive them, highest priority first. Never blocks.
+ * Call when new measurements were queued, a credit arrived or the send timer expired
+ */
+void flushSendQueue()
+{
+    uint64_t expirations;
+
+    if (sendTimerFd >= 0 && read(sendTimerFd, &expirations, sizeof(expirations)) != sizeof(expirations)) expirations = 0; // Not an error, timer did not expire if we were called for another reason
+
+    uint64_t now = getMonotonicMs();
+
+    while (_hasQueuedWork() && serialIsOpen())
+    {
+        if (!_canWrite(now))
+        {
+            if (creditFlowControl && stallStart == 0) // Start measuring how long we wait for a credit
+            {
+                stallStart = now;
+                linkStats.stalls++;
+            }
+
+            break;
+        }
+
+        if (negotiatedProtocol == PROTOCOL_FRAME)
+        {
+            framePending = false;
+
+            if (!_sendSnapshotIfDue()) _sendFrame(false);
+        }
+        else
+        {
+            _sendTextMeasurement(_dequeueNext(now), now); // Sends nothing if the latest value looks like what the client displays
+        }
+
+        now = getMonotonicMs();
     }
 
-    if (strcmp(measurements.gpuTemp, arduinoCache.gpuTemp) != 0) {
-        _sendSerial(measurements.gpuTemp, gpuTempID);
-        strcpy(arduinoCache.gpuTemp, measurements.gpuTemp);
+    _checkIncrementalPaint();
+    _armSendTimer(now);
+}
+
+
+/**
+ * Queues updated measurements for sending to the Arduino and sends what the link allows right away
+ */
+void sendMeasurements()
+{
+    uint64_t now = getMonotonicMs();
+
+    if (negotiatedProtocol == PROTOCOL_FRAME)
+    {
+        framePending = true; // _sendFrame() picks what changed by more than its deadband when it is actually written
+    }
+    else
+    {
+        // Queue what changed by more than its deadband
+        for (int i = 0; i < MEASUREMENT_COUNT; i++)
+        {
+            if (metricRegistry[i].protocolId == pingID || queued[i] || !_exceedsDeadband(i, now)) continue;
+
+            queued[i]      = true;
+            queuedSince[i] = now;
+        }
     }
 
+    flushSendQueue();
+
 
-    // Send alive ping if nothing was written in the last 5 secs to prevent Connection Lost screen from showing
-    if (clock() - lastWriteTime > 5000) {
+    // Send alive ping if nothing was written in the last 5 secs to prevent Connection Lost screen from showing. Frames send an empty frame instead
+    if (negotiatedProtocol == PROTOCOL_TEXT && !_hasQueuedWork() && getMonotonicMs() - lastWriteTime > 5000 && _canWrite(getMonotonicMs())) {
         logDebug("Sending alive ping!");
 
         _sendSerial("", pingID);
@@ -128,9 +700,25 @@ void sendMeasurements()
  */
 void logMeasurements()
 {
-    printf("CPU: %s%% %s°C\n", measurements.cpuLoad, measurements.cpuTemp);
-    printf("RAM: %sGB %sGB\n", measurements.ramUsage, measurements.swapUsage);
-    printf("GPU: %s%% %s°C\n", measurements.gpuLoad, measurements.gpuTemp);
+    char str[dataSize];
+
+    for (int i = 0; i < MEASUREMENT_COUNT; i++)
+    {
+        formatMeasurement(str, sizeof(str), i, &measurements.m[i]);
+
+        uint8_t unit = (measurements.m[i].valid) ? measurements.m[i].unit : metricRegistry[i].unit; // Unit might have been overridden at runtime
+
+        printf("%s: %s%s\n", metricRegistry[i].label, str, unitSuffixes[unit]);
+    }
+
+    printf("CPU Cores: %u, Avg: %u%%, Max: %u%%, Busiest:", cpuCoreStats.coreCount, (cpuCoreStats.average + 5) / 10, (cpuCoreStats.maxCore + 5) / 10);
+
+    for (int i = 0; i < cpuBusiestCoresAmount && cpuCoreStats.busiestLoads[i] >= 0; i++)
+    {
+        printf(" cpu%u (%d%%)", cpuCoreStats.busiestCores[i], (cpuCoreStats.busiestLoads[i] + 5) / 10);
+    }
+
+    printf("\n");
 }
 
 
@@ -141,10 +729,11 @@ void resetCache()
 {
     logDebug("Resetting arduinoCache...");
 
-    memset(arduinoCache.cpuLoad,   0, dataSize);
-    memset(arduinoCache.cpuTemp,   0, dataSize);
-    memset(arduinoCache.ramUsage,  0, dataSize);
-    memset(arduinoCache.swapUsage, 0, dataSize);
-    memset(arduinoCache.gpuLoad,   0, dataSize);
-    memset(arduinoCache.gpuTemp,   0, dataSize);
+    memset(arduinoCache, 0, sizeof(arduinoCache));
+
+    memset(frameCache, 0, sizeof(frameCache));
+    memset(sentStates, 0, sizeof(sentStates));
+    memset(queued, 0, sizeof(queued));
+
+    framePending = false;
 }
@@ -4,10 +4,10 @@
  * Created Date: 2024-05-20 17:02:14
  * Author: 3urobeat
  *
- * Last Modified: 2025-12-16 18:10:22
+ * Last Modified: 2026-10-18 10:31:14
  * Modified By: 3urobeat
  *
- * Copyright (c) 2024 - 2025 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2024 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -18,91 +18,478 @@
 #include "comm.h"
 
 #include <serial.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h> // struct serial_struct, ASYNC_LOW_LATENCY
 
 
-serial_t *_connection;
+// Everything received on a port is drained into a ring buffer and split into messages from there
+#define rxBufferSize 256 // Must be a power of 2
 
-char _connectionPort[32] = "";
+struct SerialPort {
+    serial_t *handle;          // NULL if closed
+    char      path[32];
 
+    char      rxBuffer[rxBufferSize];
+    uint32_t  rxHead;          // Total amount of bytes received, masked when indexing
+    uint32_t  rxTail;          // Total amount of bytes parsed
 
-bool serialNewConnection(const char *port, uint32_t baudRate)
+    char      rxMessage[64];   // Holds an incomplete message until its end char arrives
+    uint32_t  rxMessageLength;
+
+    struct termios originalSettings; // Settings of the port before we opened it. Restored when a probe is closed without being selected
+    bool           originalSaved;
+};
+
+struct SerialPort _connection;              // Port of the established connection
+struct SerialPort _probes[maxSerialProbes]; // Ports a handshake is attempted on concurrently while connecting
+
+
+/**
+ * Drops everything received but not yet returned as message
+ */
+void _resetRxBuffer(struct SerialPort *port)
+{
+    port->rxHead          = 0;
+    port->rxTail          = 0;
+    port->rxMessageLength = 0;
+}
+
+
+/**
+ * Asks the driver to pass data on immediately instead of collecting it until its latency timer expires (16ms by default on FTDI). Not every adapter supports this
+ */
+void _enableLowLatency(struct SerialPort *port)
+{
+    struct serial_struct serialInfo;
+
+    int fd = serial_fd(port->handle);
+
+    if (ioctl(fd, TIOCGSERIAL, &serialInfo) < 0)
+    {
+        logDebug("_enableLowLatency: Driver does not support TIOCGSERIAL: %s", strerror(errno));
+        return;
+    }
+
+    if (serialInfo.flags & ASYNC_LOW_LATENCY) return; // Already enabled
+
+    serialInfo.flags |= ASYNC_LOW_LATENCY;
+
+    if (ioctl(fd, TIOCSSERIAL, &serialInfo) < 0)
+    {
+        logDebug("_enableLowLatency: Failed to enable low latency mode: %s", strerror(errno));
+        return;
+    }
+
+    logDebug("_enableLowLatency: Enabled low latency mode");
+}
+
+
+/**
+ * Controls whether the Arduino resets when we open the port. Its auto-reset circuit triggers on the falling edge of DTR, which drops when a port with HUPCL is closed.
+ * With keepDtr we clear HUPCL and assert DTR ourselves so that only the very first open after plugging the Arduino in resets it. Without, every open resets it into a known state
+ */
+void _configureDtr(struct SerialPort *port)
 {
-    // Allocate new serial handle if none exists
-    if (_connection != NULL) return false;
+    int fd = serial_fd(port->handle);
 
-    _connection = serial_new();
+    struct termios settings;
+
+    if (tcgetattr(fd, &settings) < 0)
+    {
+        logDebug("_configureDtr: Failed to get port settings: %s", strerror(errno));
+        return;
+    }
+
+    if (config.keepDtr) settings.c_cflag &= ~HUPCL;
+        else settings.c_cflag |= HUPCL;
+
+    if (tcsetattr(fd, TCSANOW, &settings) < 0)
+    {
+        logDebug("_configureDtr: Failed to set HUPCL: %s", strerror(errno));
+        return;
+    }
+
+    if (!config.keepDtr) return;
+
+
+    // Hold DTR & RTS asserted. Opening raises them already, this makes sure no driver left them dropped
+    int lines;
+
+    if (ioctl(fd, TIOCMGET, &lines) < 0)
+    {
+        logDebug("_configureDtr: Driver does not support TIOCMGET: %s", strerror(errno));
+        return;
+    }
+
+    lines |= TIOCM_DTR | TIOCM_RTS;
+
+    if (ioctl(fd, TIOCMSET, &lines) < 0)
+    {
+        logDebug("_configureDtr: Failed to assert DTR: %s", strerror(errno));
+    }
+}
+
+
+/**
+ * Restores the settings (baud rate, HUPCL, ...) a port had before _openPort(). Used for probed ports that turned out not to be our Arduino, so that unrelated devices are left as we found them
+ */
+void _restoreSettings(struct SerialPort *port)
+{
+    if (!port->handle || !port->originalSaved) return;
+
+    if (tcsetattr(serial_fd(port->handle), TCSANOW, &port->originalSettings) < 0)
+    {
+        logDebug("_restoreSettings: Failed to restore settings of '%s': %s", port->path, strerror(errno));
+    }
+
+    port->originalSaved = false;
+}
+
+
+/**
+ * Opens a port. Returns success
+ */
+bool _openPort(struct SerialPort *port, const char *path, uint32_t baudRate)
+{
+    if (port->handle != NULL) return false;
+
+    port->handle = serial_new();
+
+    // Remember the settings of the port as serial_open() replaces all of them. This fd is closed after serial_open() so that closing it never drops DTR
+    int settingsFd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+
+    port->originalSaved = (settingsFd >= 0 && tcgetattr(settingsFd, &port->originalSettings) == 0);
 
     // Attempt to open port, check if succeeded
-    int openSuccess = serial_open(_connection, port, baudRate);
+    int openSuccess = serial_open(port->handle, path, baudRate);
+
+    if (settingsFd >= 0) close(settingsFd);
 
     if (openSuccess < 0)
     {
-        printf("\033[91mError:\033[0m Failed to open connection to device '%s'! Error: %s\n", port, serial_errmsg(_connection));
-        serialClose();
+        printf("\033[91mError:\033[0m Failed to open connection to device '%s'! Error: %s\n", path, serial_errmsg(port->handle));
+        serial_free(port->handle);
+        port->handle = NULL;
         return false;
     }
 
-    strncpy(_connectionPort, port, sizeof(_connectionPort));
+    strncpy(port->path, path, sizeof(port->path) - 1);
+
+    _resetRxBuffer(port);
+    _enableLowLatency(port);
+    _configureDtr(port);
 
     return true;
 }
 
-bool serialIsOpen()
-{
-    if (!_connection) return false;
-
-    return (serial_fd(_connection) >= 0);
-}
 
-void serialClose()
+/**
+ * Closes a port if it is open
+ */
+void _closePort(struct SerialPort *port)
 {
-    if (_connection) {
-        serial_close(_connection);
-        serial_free(_connection);
+    if (port->handle) {
+        serial_close(port->handle);
+        serial_free(port->handle);
     }
 
-    _connectionPort[0] = '\0';
-    _connection = NULL;
+    port->path[0] = '\0';
+    port->handle  = NULL;
 }
 
-void serialFlushOutput()
+
+/**
+ * Changes the baud rate of a port. Returns success
+ */
+bool _setPortBaudrate(struct SerialPort *port, uint32_t baudRate)
 {
-    if (!_connection) return;
+    if (!port->handle) return false;
 
-    serial_flush(_connection);
+    if (serial_set_baudrate(port->handle, baudRate) < 0)
+    {
+        printf("\033[91mError:\033[0m Failed to set baud rate %u! Error: %s\n", baudRate, serial_errmsg(port->handle));
+        return false;
+    }
+
+    return true;
 }
 
-bool serialWrite(const char *data, size_t size)
+
+/**
+ * Writes data to a port. Returns success
+ */
+bool _writePort(struct SerialPort *port, const char *data, size_t size)
 {
-    if (!_connection) return false;
+    if (!port->handle) return false;
 
-    int writeSuccess = serial_write(_connection, data, size);
+    int writeSuccess = serial_write(port->handle, data, size);
 
     if (writeSuccess < 0)
     {
-        printf("\033[91mError:\033[0m Failed to write to device! Error: %s\n", serial_errmsg(_connection));
+        printf("\033[91mError:\033[0m Failed to write to device! Error: %s\n", serial_errmsg(port->handle));
         return false;
     }
 
     return true;
 }
 
-bool serialRead(char *dest, uint32_t timeout)
+
+/**
+ * Waits up to timeout ms for data and reads everything available into the receive buffer with a single read(). Returns amount of bytes read or -1 on error
+ */
+int _fillRxBuffer(struct SerialPort *port, uint32_t timeout)
 {
-    if (!_connection) return false;
+    uint32_t freeSpace = rxBufferSize - (port->rxHead - port->rxTail);
+
+    if (freeSpace == 0) return 0;
 
-    int readSuccess = serial_read(_connection, dest, 1, timeout);
+    int ready = serial_poll(port->handle, timeout);
 
-    if (readSuccess < 0)
+    if (ready < 0)
     {
-        printf("\033[91mError:\033[0m Failed to read from device! Error: %s\n", serial_errmsg(_connection));
+        printf("\033[91mError:\033[0m Failed to read from device! Error: %s\n", serial_errmsg(port->handle));
+        return -1;
+    }
+
+    if (ready == 0) return 0;
+
+
+    // Read into the contiguous part of the free space. Anything beyond the wrap around is picked up by the next call
+    uint32_t start  = port->rxHead & (rxBufferSize - 1);
+    uint32_t length = rxBufferSize - start;
+
+    if (length > freeSpace) length = freeSpace;
+
+    ssize_t bytesRead = read(serial_fd(port->handle), port->rxBuffer + start, length);
+
+    if (bytesRead < 0)
+    {
+        if (errno == EAGAIN || errno == EINTR) return 0;
+
+        printf("\033[91mError:\033[0m Failed to read from device! Error: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (bytesRead == 0) // Readable but nothing to read means the device is gone
+    {
+        printf("\033[91mError:\033[0m Failed to read from device! Error: Device disconnected\n");
+        return -1;
+    }
+
+    port->rxHead += bytesRead;
+
+    return bytesRead;
+}
+
+
+/**
+ * Waits up to timeout ms for the next complete message on a port and copies it, without its end char, into dest
+ */
+enum SerialMessageResult _readPortMessage(struct SerialPort *port, char *dest, size_t size, uint32_t timeout)
+{
+    if (!port->handle) return SERIAL_MESSAGE_ERROR;
+
+    uint64_t deadline = getMonotonicMs() + timeout;
+
+    while (true)
+    {
+        // Split everything buffered into messages first
+        while (port->rxTail != port->rxHead)
+        {
+            char c = port->rxBuffer[port->rxTail++ & (rxBufferSize - 1)];
+
+            // Ignore line breaks, the client terminates messages with "#\n". Null bytes are what framing errors look like, e.g. if the client reset to baud
+            if (c == '\n') continue;
+
+            if (c == '\0')
+            {
+                port->rxMessageLength = 0; // Whatever we received of this message is corrupted as well
+                return SERIAL_MESSAGE_GARBAGE;
+            }
+
+            if (c == serialEOL)
+            {
+                if (port->rxMessageLength == 0) continue;
+
+                uint32_t length = (port->rxMessageLength < size - 1) ? port->rxMessageLength : size - 1;
+
+                memcpy(dest, port->rxMessage, length);
+                dest[length] = '\0';
+
+                port->rxMessageLength = 0;
+
+                return SERIAL_MESSAGE_COMPLETE;
+            }
+
+            // Drop message if it is too long to be valid
+            if (port->rxMessageLength >= sizeof(port->rxMessage))
+            {
+                port->rxMessageLength = 0;
+                port->rxMessage[port->rxMessageLength++] = c;
+
+                return SERIAL_MESSAGE_GARBAGE;
+            }
+
+            port->rxMessage[port->rxMessageLength++] = c;
+        }
+
+
+        // Wait for more data until the deadline passed
+        uint64_t now       = getMonotonicMs();
+        uint32_t remaining = (deadline > now) ? deadline - now : 0;
+
+        int bytesRead = _fillRxBuffer(port, remaining);
+
+        if (bytesRead < 0) return SERIAL_MESSAGE_ERROR;
+
+        if (bytesRead == 0 && getMonotonicMs() >= deadline) return SERIAL_MESSAGE_NONE;
+    }
+}
+
+
+bool serialNewConnection(const char *port, uint32_t baudRate)
+{
+    return _openPort(&_connection, port, baudRate);
+}
+
+bool serialIsOpen()
+{
+    if (!_connection.handle) return false;
+
+    return (serial_fd(_connection.handle) >= 0);
+}
+
+void serialClose()
+{
+    _closePort(&_connection);
+}
+
+void serialFlushOutput()
+{
+    if (!_connection.handle) return;
+
+    serial_flush(_connection.handle);
+}
+
+bool serialSetBaudrate(uint32_t baudRate)
+{
+    return _setPortBaudrate(&_connection, baudRate);
+}
+
+void serialDiscardInput()
+{
+    if (!_connection.handle) return;
+
+    tcflush(serial_fd(_connection.handle), TCIFLUSH);
+
+    _resetRxBuffer(&_connection);
+}
+
+bool serialWrite(const char *data, size_t size)
+{
+    return _writePort(&_connection, data, size);
+}
+
+enum SerialMessageResult serialReadMessage(char *dest, size_t size, uint32_t timeout)
+{
+    return _readPortMessage(&_connection, dest, size, timeout);
+}
+
+int serialOutputWaiting()
+{
+    if (!_connection.handle) return -1;
+
+    unsigned int waiting = 0;
+
+    if (serial_output_waiting(_connection.handle, &waiting) < 0) return -1;
+
+    return waiting;
+}
+
+int serialGetFd()
+{
+    if (!_connection.handle) return -1;
+
+    return serial_fd(_connection.handle);
+}
+
+char *serialGetPort()
+{
+    return _connection.path;
+}
+
+
+bool serialProbeOpen(int probe, const char *port, uint32_t baudRate)
+{
+    if (probe < 0 || probe >= maxSerialProbes) return false;
+
+    return _openPort(&_probes[probe], port, baudRate);
+}
+
+void serialProbeClose(int probe)
+{
+    _restoreSettings(&_probes[probe]); // The selected probe is handed over by serialProbeSelect() instead and keeps its setting
+    _closePort(&_probes[probe]);
+}
+
+bool serialProbeResetDevice(int probe)
+{
+    if (!_probes[probe].handle) return false;
+
+    int fd    = serial_fd(_probes[probe].handle);
+    int lines = TIOCM_DTR | TIOCM_RTS;
+
+    // The auto-reset circuit triggers when DTR gets asserted again
+    if (ioctl(fd, TIOCMBIC, &lines) < 0)
+    {
+        logDebug("serialProbeResetDevice: Failed to drop DTR: %s", strerror(errno));
         return false;
     }
 
+    usleep(100000);
+
+    if (ioctl(fd, TIOCMBIS, &lines) < 0)
+    {
+        logDebug("serialProbeResetDevice: Failed to assert DTR: %s", strerror(errno));
+        return false;
+    }
+
+    tcflush(fd, TCIFLUSH);
+    _resetRxBuffer(&_probes[probe]);
+
     return true;
 }
 
-char *serialGetPort()
+bool serialProbeWrite(int probe, const char *data, size_t size)
+{
+    return _writePort(&_probes[probe], data, size);
+}
+
+enum SerialMessageResult serialProbeReadMessage(int probe, char *dest, size_t size, uint32_t timeout)
 {
-    return _connectionPort;
+    return _readPortMessage(&_probes[probe], dest, size, timeout);
+}
+
+int serialProbeGetFd(int probe)
+{
+    if (!_probes[probe].handle) return -1;
+
+    return serial_fd(_probes[probe].handle);
+}
+
+char *serialProbeGetPort(int probe)
+{
+    return _probes[probe].path;
+}
+
+void serialProbeSelect(int probe)
+{
+    _closePort(&_connection);
+
+    // Hand the open port over including everything it received so far
+    _connection = _probes[probe];
+
+    memset(&_probes[probe], 0, sizeof(_probes[probe]));
 }
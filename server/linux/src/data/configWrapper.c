@@ -4,10 +4,10 @@
  * Created Date: 2024-05-26 11:19:03
  * Author: 3urobeat
  *
- * Last Modified: 2024-10-02 22:27:54
+ * Last Modified: 2026-10-18 07:52:19
  * Modified By: 3urobeat
  *
- * Copyright (c) 2024 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2024 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -69,6 +69,8 @@ void _createDefaultConfig()
 
 void _parseStringConfigEntry(const toml_table_t *arr, const char *key, char *dest, size_t size)
 {
+    if (!arr) return; // Table does not exist, keep the current value
+
     toml_datum_t value = toml_string_in(arr, key);
 
     if (value.ok) strncpy(dest, value.u.s, size);
@@ -79,14 +81,28 @@ void _parseStringConfigEntry(const toml_table_t *arr, const char *key, char *des
 
 void _parseIntConfigEntry(const toml_table_t *arr, const char *key, int *dest)
 {
+    if (!arr) return; // Table does not exist, keep the current value
+
     toml_datum_t value = toml_int_in(arr, key);
 
     if (value.ok) *dest = value.u.i;
         else printf("\033[91mError:\033[0m Config key '%s' is not ok! Ignoring config key...\n", key);
 }
 
+void _parseBoolConfigEntry(const toml_table_t *arr, const char *key, bool *dest)
+{
+    if (!arr) return; // Table does not exist, keep the current value
+
+    toml_datum_t value = toml_bool_in(arr, key);
+
+    if (value.ok) *dest = value.u.b;
+        else printf("\033[91mError:\033[0m Config key '%s' is not ok! Ignoring config key...\n", key);
+}
+
 void _parseFloatConfigEntry(const toml_table_t *arr, const char *key, float *dest)
 {
+    if (!arr) return; // Table does not exist, keep the current value
+
     toml_datum_t value = toml_double_in(arr, key);
 
     if (value.ok) *dest = (float) value.u.d;
@@ -125,6 +141,12 @@ void _parseConfig()
     _parseFloatConfigEntry(timeouts, "connectionRetryMultiplier", &config.connectionRetryMultiplier);
 
 
+    // Traverse the 'connection' table
+    toml_table_t* connection = toml_table_in(conf, "connection");
+
+    _parseStringConfigEntry(connection, "serialNumber", config.serialNumber, sizeof(config.serialNumber));
+    _parseBoolConfigEntry(connection, "keepDtr", &config.keepDtr);
+
 
     // Traverse the 'sensors' table
     toml_table_t* sensors = toml_table_in(conf, "sensors");
@@ -135,10 +157,48 @@ void _parseConfig()
     if (strcmp(temp, "amd") == 0)    config.gpuType = AMD;
     if (strcmp(temp, "nvidia") == 0) config.gpuType = NVIDIA;
 
+    memset(temp, 0, sizeof(temp));
+    _parseStringConfigEntry(sensors, "cpuLoadMode", temp, sizeof(temp));
+
+    if (strcmp(temp, "average") == 0) config.cpuLoadMode = AVERAGE;
+    if (strcmp(temp, "maxCore") == 0) config.cpuLoadMode = MAX_CORE;
+
     _parseStringConfigEntry(sensors, "cpuTempSensorPath", config.cpuTempSensorPath, sizeof(config.cpuTempSensorPath));
     _parseStringConfigEntry(sensors, "gpuLoadSensorPath", config.gpuLoadSensorPath, sizeof(config.gpuLoadSensorPath));
     _parseStringConfigEntry(sensors, "gpuTempSensorPath", config.gpuTempSensorPath, sizeof(config.gpuTempSensorPath));
     _parseIntConfigEntry(sensors, "checkInterval", &config.checkInterval);
+    _parseIntConfigEntry(sensors, "sampleInterval", &config.sampleInterval);
+
+    memset(temp, 0, sizeof(temp));
+    _parseStringConfigEntry(sensors, "sampleAggregation", temp, sizeof(temp));
+
+    if (strcmp(temp, "max") == 0)  config.sampleAggregation = AGGREGATE_MAX;
+    if (strcmp(temp, "mean") == 0) config.sampleAggregation = AGGREGATE_MEAN;
+    if (strcmp(temp, "ewma") == 0) config.sampleAggregation = AGGREGATE_EWMA;
+
+    _parseStringConfigEntry(sensors, "meminfoMetric", config.meminfoMetric, sizeof(config.meminfoMetric));
+
+
+    // Traverse the 'sampleIntervals' table
+    toml_table_t* sampleIntervals = toml_table_in(conf, "sampleIntervals");
+
+    _parseIntConfigEntry(sampleIntervals, "cpuLoad", &config.sampleIntervals.cpuLoad);
+    _parseIntConfigEntry(sampleIntervals, "cpuTemp", &config.sampleIntervals.cpuTemp);
+    _parseIntConfigEntry(sampleIntervals, "ramUsage", &config.sampleIntervals.ramUsage);
+    _parseIntConfigEntry(sampleIntervals, "gpuLoad", &config.sampleIntervals.gpuLoad);
+    _parseIntConfigEntry(sampleIntervals, "gpuTemp", &config.sampleIntervals.gpuTemp);
+
+
+    // Traverse the 'deadbands' table
+    toml_table_t* deadbands = toml_table_in(conf, "deadbands");
+
+    _parseFloatConfigEntry(deadbands, "cpuLoad", &config.deadbands.cpuLoad);
+    _parseFloatConfigEntry(deadbands, "cpuTemp", &config.deadbands.cpuTemp);
+    _parseFloatConfigEntry(deadbands, "ramUsage", &config.deadbands.ramUsage);
+    _parseFloatConfigEntry(deadbands, "swapUsage", &config.deadbands.swapUsage);
+    _parseFloatConfigEntry(deadbands, "gpuLoad", &config.deadbands.gpuLoad);
+    _parseFloatConfigEntry(deadbands, "gpuTemp", &config.deadbands.gpuTemp);
+    _parseIntConfigEntry(deadbands, "maxStaleness", &config.deadbands.maxStaleness);
 
 
     // Free memory
@@ -146,6 +206,15 @@ void _parseConfig()
 }
 
 
+/**
+ * Returns the path of our config directory, ending with a slash. Empty until importConfigFile() ran
+ */
+const char *getConfigDirPath()
+{
+    return _configDirPath;
+}
+
+
 /**
  * Imports config file from the disk and parses it into config struct
  */
@@ -4,10 +4,10 @@
  * Created Date: 2024-05-26 14:00:50
  * Author: 3urobeat
  *
- * Last Modified: 2024-10-02 22:21:24
+ * Last Modified: 2026-10-18 07:52:19
  * Modified By: 3urobeat
  *
- * Copyright (c) 2024 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2024 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -17,6 +17,18 @@
 
 #pragma once
 
+#include <stdbool.h>
+
+
+// Persistent file descriptor which is re-read using pread() on every measurement instead of opening the file again.
+// Defined before including server.h because sensors.h embeds it
+struct FileHandle {
+    char path[128];
+    int  fd;
+    bool failing; // Set while reads fail so that the error is only logged once
+};
+
+
 #include "../server.h"
 
 
@@ -28,12 +40,33 @@
                         "\nconnectionRetryTimeout = 5000" \
                         "\nconnectionRetryAmount = 10" \
                         "\nconnectionRetryMultiplier = 0.5" \
+                        "\n\n[connection]" \
+                        "\nserialNumber = \"\"" \
+                        "\nkeepDtr = true" \
                         "\n\n[sensors]" \
                         "\ngpuType = \"amd\"" \
+                        "\ncpuLoadMode = \"average\"" \
                         "\ncpuTempSensorPath = \"\"" \
                         "\ngpuLoadSensorPath = \"\"" \
                         "\ngpuTempSensorPath = \"\"" \
                         "\ncheckInterval = 1000" \
+                        "\nsampleInterval = 250" \
+                        "\nsampleAggregation = \"max\"" \
+                        "\nmeminfoMetric = \"\"" \
+                        "\n\n[sampleIntervals]" \
+                        "\ncpuLoad = 0" \
+                        "\ncpuTemp = 1000" \
+                        "\nramUsage = 1000" \
+                        "\ngpuLoad = 0" \
+                        "\ngpuTemp = 1000" \
+                        "\n\n[deadbands]" \
+                        "\ncpuLoad = 2.0" \
+                        "\ncpuTemp = 1.0" \
+                        "\nramUsage = 0.1" \
+                        "\nswapUsage = 0.1" \
+                        "\ngpuLoad = 2.0" \
+                        "\ngpuTemp = 1.0" \
+                        "\nmaxStaleness = 10000" \
                         "\n"
 
 // GpuType to int mapping
@@ -42,6 +75,39 @@ enum GpuType {
     NVIDIA = 1
 };
 
+// CpuLoadMode to int mapping
+enum CpuLoadMode {
+    AVERAGE  = 0,
+    MAX_CORE = 1
+};
+
+// SampleAggregation to int mapping
+enum SampleAggregation {
+    AGGREGATE_MAX  = 0,
+    AGGREGATE_MEAN = 1,
+    AGGREGATE_EWMA = 2
+};
+
+// Sample interval of every sensor in ms. 0 uses sampleInterval
+struct SampleIntervalValues {
+    int cpuLoad;                     // Also used for iowait & steal
+    int cpuTemp;
+    int ramUsage;                    // Also used for swap
+    int gpuLoad;
+    int gpuTemp;
+};
+
+// Minimum change of every measurement before it is sent to the client again, in the unit of the measurement
+struct DeadbandValues {
+    float cpuLoad;                   // in %
+    float cpuTemp;                   // in °C
+    float ramUsage;                  // in GB
+    float swapUsage;                 // in GB
+    float gpuLoad;                   // in %
+    float gpuTemp;                   // in °C
+    int maxStaleness;                // Send smaller changes anyway once the displayed value is older than this many ms
+};
+
 // Stores currently imported config
 struct ConfigValues {
     // General
@@ -53,12 +119,26 @@ struct ConfigValues {
     int connectionRetryAmount;       // How often to retry finding a connection
     float connectionRetryMultiplier; // retry * connectionRetryTimeout * connectionRetryMultiplier
 
+    // Connection
+    char serialNumber[64];           // USB serial number of the Arduino, probed before all other ports. Empty to rank by USB IDs only
+    bool keepDtr;                    // Keeps DTR asserted when opening & closing ports so that the Arduino does not reset every time we connect
+
     // Sensors
     enum GpuType gpuType;            // 0 for automatic discovery (AMD), 1 for Nvidia (nvidia-settings will be used)
+    enum CpuLoadMode cpuLoadMode;    // 0 to display the load of all cores combined, 1 to display the load of the busiest core
     char cpuTempSensorPath[128];
     char gpuLoadSensorPath[128];
     char gpuTempSensorPath[128];
-    int checkInterval;               // 1 second is lowest value possibe as mpstat takes a second to collect data
+    int checkInterval;               // How often measurements are sent to the client in ms
+    int sampleInterval;              // How often sensors are read in ms. All samples taken during one checkInterval are combined using sampleAggregation
+    enum SampleAggregation sampleAggregation;
+    char meminfoMetric[32];          // Any '/proc/meminfo' key (e.g. 'Dirty') to sample as additional metric. Empty to disable
+
+    // Sample intervals
+    struct SampleIntervalValues sampleIntervals;
+
+    // Deadbands
+    struct DeadbandValues deadbands;
 };
 
 extern struct ConfigValues config;
@@ -67,7 +147,14 @@ extern struct ConfigValues config;
 // Functions to export
 extern void importConfigFile();
 extern void exportConfigFile();
+extern const char *getConfigDirPath();
 
 extern void getCmdStdout(char *dest, int size, const char *cmd);
 extern void getFileContent(char *dest, int size, const char *path, const char delim);
 #define getFileContentFull(dest, size, path) getFileContent(dest, size, path, '\0') // Overload to omit delimiter and read till null byte
+
+extern bool fileHandleOpen(struct FileHandle *handle, const char *path);
+extern void fileHandleClose(struct FileHandle *handle);
+extern ssize_t fileHandleRead(struct FileHandle *handle, char *dest, size_t size, off_t offset);
+extern void getHandleContent(char *dest, int size, struct FileHandle *handle, const char delim);
+#define getHandleContentFull(dest, size, handle) getHandleContent(dest, size, handle, '\0') // Overload to omit delimiter and read till null byte
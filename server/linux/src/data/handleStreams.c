@@ -4,10 +4,10 @@
  * Created Date: 2024-05-22 17:57:28
  * Author: 3urobeat
  *
- * Last Modified: 2024-06-04 18:03:01
+ * Last Modified: 2026-10-18 09:04:41
  * Modified By: 3urobeat
  *
- * Copyright (c) 2024 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2024 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -17,6 +17,8 @@
 
 #include "data.h"
 
+#include <fcntl.h>
+
 
 /**
  * Reads a FILE stream until encountering delim or EOF and writes into dest
@@ -103,3 +105,114 @@ void getFileContent(char *dest, int size, const char *path, const char delim)
     // Debug log result and return size
     logDebug("getFileContent(): Read '%s' from '%s'", dest, path);
 }
+
+
+/**
+ * Opens a persistent file handle for path. The handle can then be re-read every measurement using fileHandleRead() without opening the file again. Returns success.
+ */
+bool fileHandleOpen(struct FileHandle *handle, const char *path)
+{
+    strncpy(handle->path, path, sizeof(handle->path) - 1);
+    handle->path[sizeof(handle->path) - 1] = '\0';
+
+    errno = 0;
+    handle->fd = open(handle->path, O_RDONLY | O_CLOEXEC);
+
+    handle->failing = (handle->fd < 0); // fileHandleRead() does not need to log this again
+
+    if (handle->fd < 0)
+    {
+        printf("\033[91mError:\033[0m Failed to open '%s'! Error: %s\n", handle->path, strerror(errno));
+        return false;
+    }
+
+    logDebug("fileHandleOpen(): Opened '%s' as fd %d", handle->path, handle->fd);
+
+    return true;
+}
+
+
+/**
+ * Closes a file handle opened by fileHandleOpen(). Does nothing if handle is not open.
+ */
+void fileHandleClose(struct FileHandle *handle)
+{
+    if (handle->fd >= 0) (void) close(handle->fd);
+
+    handle->fd = -1;
+}
+
+
+/**
+ * Reads up to size bytes from offset of a file handle using a single pread() call. Transparently reopens the file if a read fails, e.g. because the device went away (ENODEV/ESTALE).
+ * Failures are only logged when the handle starts and stops failing, a sensor that is gone would otherwise log an error every sample. Returns amount of bytes read or -1 on error.
+ */
+ssize_t fileHandleRead(struct FileHandle *handle, char *dest, size_t size, off_t offset)
+{
+    if (handle->path[0] == '\0') return -1; // Handle was never opened
+
+    ssize_t bytesRead = -1;
+
+    if (handle->fd >= 0) bytesRead = pread(handle->fd, dest, size, offset);
+
+    // Sensor might have been re-created (e.g. driver reload, hwmon re-enumeration) or a previous read failed. Reopen once and try again
+    if (bytesRead < 0)
+    {
+        if (handle->fd >= 0)
+        {
+            logDebug("fileHandleRead(): Reading '%s' failed with '%s', reopening...", handle->path, strerror(errno));
+        }
+
+        fileHandleClose(handle);
+
+        errno = 0;
+        handle->fd = open(handle->path, O_RDONLY | O_CLOEXEC);
+
+        if (handle->fd >= 0) bytesRead = pread(handle->fd, dest, size, offset);
+    }
+
+    if (bytesRead < 0)
+    {
+        if (!handle->failing) printf("\033[91mError:\033[0m Failed to read '%s'! Error: %s. Retrying every sample without logging...\n", handle->path, strerror(errno));
+
+        handle->failing = true;
+        fileHandleClose(handle);
+    }
+    else if (handle->failing)
+    {
+        printf("Reading '%s' works again.\n", handle->path);
+
+        handle->failing = false;
+    }
+
+    return bytesRead;
+}
+
+
+/**
+ * Reads the content of a file handle until encountering delim or EOF and writes into dest. Equivalent to getFileContent() but without re-opening the file.
+ */
+void getHandleContent(char *dest, int size, struct FileHandle *handle, const char delim)
+{
+    ssize_t bytesRead = fileHandleRead(handle, dest, size - 1, 0);
+
+    if (bytesRead < 0) bytesRead = 0;
+
+    dest[bytesRead] = '\0';
+
+    // Cut content at delimiter if one was specified
+    if (delim != '\0')
+    {
+        char *delimPtr = memchr(dest, delim, bytesRead);
+
+        if (delimPtr) {
+            *delimPtr = '\0';
+            bytesRead = delimPtr - dest;
+        }
+    }
+
+    // Remove trailing newline, just like _readStream() does
+    if (bytesRead > 0 && dest[bytesRead - 1] == '\n') dest[bytesRead - 1] = '\0';
+
+    logDebug("getHandleContent(): Read '%s' from '%s'", dest, handle->path);
+}
@@ -4,10 +4,10 @@
  * Created Date: 2023-01-24 17:14:44
  * Author: 3urobeat
  *
- * Last Modified: 2024-05-26 14:17:28
+ * Last Modified: 2026-10-17 22:46:12
  * Modified By: 3urobeat
  *
- * Copyright (c) 2023 - 2024 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2023 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -20,6 +20,55 @@
 #include "../server.h"
 
 
+// Time spent by a CPU in each state, in jiffies. See 1.8 @ https://www.kernel.org/doc/Documentation/filesystems/proc.txt
+struct CpuTimes {
+    uint64_t user;
+    uint64_t nice;
+    uint64_t system;
+    uint64_t idle;
+    uint64_t iowait;
+    uint64_t irq;
+    uint64_t softirq;
+    uint64_t steal;
+    uint64_t guest;   // Already included in user
+};
+
+
+// Periodic task run by a TickScheduler on absolute CLOCK_MONOTONIC deadlines
+struct TickTask {
+    const char *name;
+    void      (*callback)();
+    uint32_t    order;          // Tasks with the same deadline run in the order they were added
+    uint64_t    periodNs;
+    uint64_t    nextDeadlineNs; // Absolute CLOCK_MONOTONIC time of the next run
+    uint64_t    ticks;          // Amount of runs
+    uint64_t    overruns;       // Amount of runs skipped because a previous run took too long
+    uint64_t    jitterMinNs;    // How late runs were handled after their deadline
+    uint64_t    jitterMaxNs;
+    uint64_t    jitterSumNs;
+};
+
+// Drift-free timer wheel for multiple periodic tasks, sharing one timerfd. Tasks are kept in a min-heap by deadline
+#define maxTickTasks 16
+
+struct TickScheduler {
+    int              fd;        // timerfd to add to the event loop
+    struct TickTask *heap[maxTickTasks];
+    uint32_t         size;
+    uint64_t         startNs;   // CLOCK_MONOTONIC time the scheduler was created, deadlines of all tasks are based on it
+};
+
+
 // Functions to export
 extern bool strStartsWith(const char *searchFor, const char *searchInStr);
-extern void floatToFixedLengthStr(char *dest, float num);
+extern uint64_t getMonotonicMs();
+extern uint8_t crc8(const uint8_t *data, size_t size);
+
+extern bool tickSchedulerInit(struct TickScheduler *scheduler);
+extern bool tickSchedulerAddTask(struct TickScheduler *scheduler, struct TickTask *task, const char *name, uint32_t periodMs, void (*callback)());
+extern void tickSchedulerHandle(struct TickScheduler *scheduler);
+extern void tickSchedulerPrintStats(const struct TickScheduler *scheduler);
+
+extern bool parseNextUint64(const char **ptr, uint64_t *dest);
+extern const char *skipToNextLine(const char *ptr);
+extern void parseCpuTimes(const char **ptr, struct CpuTimes *dest);
@@ -4,10 +4,10 @@
  * Created Date: 2024-05-19 18:19:26
  * Author: 3urobeat
  *
- * Last Modified: 2024-05-22 18:42:15
+ * Last Modified: 2026-10-17 22:46:12
  * Modified By: 3urobeat
  *
- * Copyright (c) 2024 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2024 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -28,23 +28,33 @@ bool strStartsWith(const char *searchFor, const char *searchInStr)
 
 
 /**
- * Formats float below 100 to always show one and 100-999 to show no decimal. Writes result into dest.
+ * Returns milliseconds since an arbitrary point in time. Unlike clock() this counts wall time and unlike CLOCK_REALTIME it never jumps
  */
-void floatToFixedLengthStr(char *dest, float num)
+uint64_t getMonotonicMs()
 {
-    if (num > 999.9) return;
+    struct timespec timeStruct;
+    clock_gettime(CLOCK_MONOTONIC, &timeStruct);
 
-    memset(dest, '\0', 4); // Clear the memory we need
-    gcvt(num, 3, dest);
+    return (uint64_t) timeStruct.tv_sec * 1000 + timeStruct.tv_nsec / 1000000;
+}
+
+
+/**
+ * Calculates the CRC-8 (polynomial 0x07, init 0x00) of size bytes
+ */
+uint8_t crc8(const uint8_t *data, size_t size)
+{
+    uint8_t crc = 0;
 
-    for (int i = 0; i < 3; i++) // Nifty loop for number formatting: Make numbers below 100 show always one decimal.
+    for (size_t i = 0; i < size; i++)
     {
-        if (*(dest + i) == '.' || dest[i] == '\0')
+        crc ^= data[i];
+
+        for (int bit = 0; bit < 8; bit++)
         {
-            *(dest + i) = '.';
-            *(dest + i + 1) = *(dest + i + 1) ? *(dest + i + 1) : '0';
-            *(dest + i + 2) = '\0';
-            break;
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
         }
     }
+
+    return crc;
 }
@@ -0,0 +1,217 @@
+/*
+ * File: tickScheduler.c
+ * Project: arduino-resource-monitor
+ * Created Date: 2026-10-17 17:05:12
+ * Author: 3urobeat
+ *
+ * Last Modified: 2026-10-18 03:55:10
+ * Modified By: 3urobeat
+ *
+ * Copyright (c) 2026 3urobeat <https://github.com/3urobeat>
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "helpers.h"
+
+#include <inttypes.h>
+#include <sys/timerfd.h>
+
+
+/**
+ * Returns nanoseconds on CLOCK_MONOTONIC
+ */
+uint64_t _getMonotonicNs()
+{
+    struct timespec timeStruct;
+    clock_gettime(CLOCK_MONOTONIC, &timeStruct);
+
+    return (uint64_t) timeStruct.tv_sec * 1000000000 + timeStruct.tv_nsec;
+}
+
+
+/**
+ * Returns true if task a is due before task b. Tasks with the same deadline run in the order they were added
+ */
+bool _taskBefore(const struct TickTask *a, const struct TickTask *b)
+{
+    if (a->nextDeadlineNs != b->nextDeadlineNs) return a->nextDeadlineNs < b->nextDeadlineNs;
+
+    return a->order < b->order;
+}
+
+
+/**
+ * Restores the heap property by moving the task at index up
+ */
+void _siftUp(struct TickScheduler *scheduler, uint32_t index)
+{
+    while (index > 0)
+    {
+        uint32_t parent = (index - 1) / 2;
+
+        if (!_taskBefore(scheduler->heap[index], scheduler->heap[parent])) break;
+
+        struct TickTask *temp   = scheduler->heap[parent];
+        scheduler->heap[parent] = scheduler->heap[index];
+        scheduler->heap[index]  = temp;
+
+        index = parent;
+    }
+}
+
+
+/**
+ * Restores the heap property by moving the task at index down
+ */
+void _siftDown(struct TickScheduler *scheduler, uint32_t index)
+{
+    while (true)
+    {
+        uint32_t left     = index * 2 + 1;
+        uint32_t right    = left + 1;
+        uint32_t smallest = index;
+
+        if (left < scheduler->size && _taskBefore(scheduler->heap[left], scheduler->heap[smallest]))   smallest = left;
+        if (right < scheduler->size && _taskBefore(scheduler->heap[right], scheduler->heap[smallest])) smallest = right;
+
+        if (smallest == index) break;
+
+        struct TickTask *temp     = scheduler->heap[smallest];
+        scheduler->heap[smallest] = scheduler->heap[index];
+        scheduler->heap[index]    = temp;
+
+        index = smallest;
+    }
+}
+
+
+/**
+ * Arms the timerfd to fire once at the absolute deadline of the task that is due next
+ */
+void _armTickScheduler(struct TickScheduler *scheduler)
+{
+    if (scheduler->size == 0) return;
+
+    uint64_t deadline = scheduler->heap[0]->nextDeadlineNs;
+
+    struct itimerspec timerSpec = {
+        .it_interval = { 0, 0 },
+        .it_value    = { .tv_sec = deadline / 1000000000, .tv_nsec = deadline % 1000000000 }
+    };
+
+    timerfd_settime(scheduler->fd, TFD_TIMER_ABSTIME, &timerSpec, NULL);
+}
+
+
+/**
+ * Creates the timerfd of a scheduler. Add scheduler->fd to your event loop. Returns success
+ */
+bool tickSchedulerInit(struct TickScheduler *scheduler)
+{
+    memset(scheduler, 0, sizeof(struct TickScheduler));
+
+    scheduler->fd      = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    scheduler->startNs = _getMonotonicNs();
+
+    return scheduler->fd >= 0;
+}
+
+
+/**
+ * Adds a task which runs callback every periodMs on absolute CLOCK_MONOTONIC deadlines. task must stay valid while the scheduler runs. Returns success
+ */
+bool tickSchedulerAddTask(struct TickScheduler *scheduler, struct TickTask *task, const char *name, uint32_t periodMs, void (*callback)())
+{
+    if (scheduler->size >= maxTickTasks) return false;
+
+    memset(task, 0, sizeof(struct TickTask));
+
+    task->name           = name;
+    task->callback       = callback;
+    task->order          = scheduler->size;
+    task->periodNs       = (uint64_t) periodMs * 1000000;
+    task->nextDeadlineNs = scheduler->startNs + task->periodNs; // Share the same start time so that tasks with related periods stay in phase
+    task->jitterMinNs    = UINT64_MAX;
+
+    scheduler->heap[scheduler->size] = task;
+    scheduler->size++;
+
+    _siftUp(scheduler, scheduler->size - 1);
+    _armTickScheduler(scheduler);
+
+    return true;
+}
+
+
+/**
+ * Runs every task that is due and arms the next deadline. Call when scheduler->fd is readable.
+ * Deadlines advance by exactly one period from the previous deadline, not from now, so the time spent in callbacks does not accumulate as drift.
+ * Deadlines which already passed because a callback took longer than a period are counted as overruns and merged into one call instead of being queued.
+ */
+void tickSchedulerHandle(struct TickScheduler *scheduler)
+{
+    uint64_t expirations;
+
+    if (read(scheduler->fd, &expirations, sizeof(expirations)) != sizeof(expirations)) return;
+
+    while (scheduler->size > 0)
+    {
+        struct TickTask *task = scheduler->heap[0];
+        uint64_t now = _getMonotonicNs();
+
+        if (task->nextDeadlineNs > now) break;
+
+        // Collect jitter stats
+        uint64_t lateness = now - task->nextDeadlineNs;
+
+        if (lateness < task->jitterMinNs) task->jitterMinNs = lateness;
+        if (lateness > task->jitterMaxNs) task->jitterMaxNs = lateness;
+
+        task->jitterSumNs += lateness;
+        task->ticks++;
+
+        // Skip all deadlines that already passed
+        uint64_t missed = lateness / task->periodNs;
+
+        task->overruns       += missed;
+        task->nextDeadlineNs += (missed + 1) * task->periodNs;
+
+        if (missed > 0)
+        {
+            logDebug("tickSchedulerHandle: Task '%s' overran by %" PRIu64 " ticks (%.1fms late), skipping them", task->name, missed, lateness / 1000000.0);
+        }
+
+        // Reschedule before running so that the callback may take as long as it wants
+        _siftDown(scheduler, 0);
+
+        task->callback();
+    }
+
+    _armTickScheduler(scheduler);
+}
+
+
+/**
+ * Prints tick count, overruns and jitter (how late ticks were handled) of every task to stdout
+ */
+void tickSchedulerPrintStats(const struct TickScheduler *scheduler)
+{
+    for (uint32_t i = 0; i < scheduler->size; i++)
+    {
+        const struct TickTask *task = scheduler->heap[i];
+
+        if (task->ticks == 0) continue;
+
+        printf("Task '%s': %" PRIu64 " ticks, %" PRIu64 " overruns, jitter min/avg/max %.2f/%.2f/%.2fms\n",
+               task->name,
+               task->ticks,
+               task->overruns,
+               task->jitterMinNs / 1000000.0,
+               (task->jitterSumNs / task->ticks) / 1000000.0,
+               task->jitterMaxNs / 1000000.0);
+    }
+}
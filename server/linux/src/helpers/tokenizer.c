@@ -0,0 +1,79 @@
+/*
+ * File: tokenizer.c
+ * Project: arduino-resource-monitor
+ * Created Date: 2026-10-17 12:04:55
+ * Author: 3urobeat
+ *
+ * Last Modified: 2026-10-17 12:31:08
+ * Modified By: 3urobeat
+ *
+ * Copyright (c) 2026 3urobeat <https://github.com/3urobeat>
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "helpers.h"
+
+
+/**
+ * Parses the next unsigned number of the current line in place, without modifying the string or calling any libc functions.
+ * Skips leading spaces & tabs and advances *ptr behind the parsed number. Returns false (and leaves dest untouched) if no number follows.
+ */
+bool parseNextUint64(const char **ptr, uint64_t *dest)
+{
+    const char *p = *ptr;
+
+    while (*p == ' ' || *p == '\t') p++;
+
+    *ptr = p;
+
+    if ((uint8_t) (*p - '0') > 9) return false; // Unsigned underflow makes this a single compare for '0'-'9'
+
+    uint64_t value = 0;
+
+    do {
+        value = value * 10 + (uint8_t) (*p - '0');
+        p++;
+    } while ((uint8_t) (*p - '0') <= 9);
+
+    *dest = value;
+    *ptr  = p;
+
+    return true;
+}
+
+
+/**
+ * Returns a pointer to the first char of the next line or to the terminating null byte if there is none
+ */
+const char *skipToNextLine(const char *ptr)
+{
+    while (*ptr != '\n' && *ptr != '\0') ptr++;
+
+    if (*ptr == '\n') ptr++;
+
+    return ptr;
+}
+
+
+/**
+ * Parses the columns of a '/proc/stat' cpu line into dest, starting behind the line title. Columns missing on older kernels are set to 0.
+ * Advances *ptr behind the last parsed column - see 1.8 @ https://www.kernel.org/doc/Documentation/filesystems/proc.txt
+ */
+void parseCpuTimes(const char **ptr, struct CpuTimes *dest)
+{
+    memset(dest, 0, sizeof(struct CpuTimes));
+
+    (void) (parseNextUint64(ptr, &dest->user)    // Stop at the first missing column
+        && parseNextUint64(ptr, &dest->nice)
+        && parseNextUint64(ptr, &dest->system)
+        && parseNextUint64(ptr, &dest->idle)
+        && parseNextUint64(ptr, &dest->iowait)
+        && parseNextUint64(ptr, &dest->irq)
+        && parseNextUint64(ptr, &dest->softirq)
+        && parseNextUint64(ptr, &dest->steal)
+        && parseNextUint64(ptr, &dest->guest));
+}
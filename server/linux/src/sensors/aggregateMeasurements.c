@@ -0,0 +1,162 @@
+/*
+ * File: aggregateMeasurements.c
+ * Project: arduino-resource-monitor
+ * Created Date: 2026-10-17 15:21:44
+ * Author: 3urobeat
+ *
+ * Last Modified: 2026-10-18 09:56:08
+ * Modified By: 3urobeat
+ *
+ * Copyright (c) 2026 3urobeat <https://github.com/3urobeat>
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "sensors.h"
+
+
+// Stores the measurements produced by the last emitMeasurements() call. Only accessed by the sampler thread
+struct MeasurementStore sampledMeasurements;
+
+
+// Folds all samples taken between two emitMeasurements() calls
+#define ewmaShift 8 // The EWMA is kept with 8 additional fractional bits so that small steps do not get lost to integer truncation
+
+struct Accumulator {
+    int64_t  sum;
+    int32_t  max;
+    int64_t  ewma;            // Shifted left by ewmaShift
+    uint32_t count;           // Amount of samples since the last emit
+    bool     ewmaInitialized;
+};
+
+struct Accumulator accumulators[MEASUREMENT_COUNT];
+
+
+// Scale & unit of measurements whose unit is only known at runtime. A scale of 0 uses the metricRegistry entry
+struct UnitOverride {
+    uint16_t             scale;
+    enum MeasurementUnit unit;
+};
+
+struct UnitOverride unitOverrides[MEASUREMENT_COUNT];
+
+
+/**
+ * Folds a new sample into the accumulator of a measurement. Does not allocate, safe to call at a high rate
+ */
+void addSample(enum MeasurementIndex index, int32_t value)
+{
+    struct Accumulator *acc = &accumulators[index];
+
+    if (acc->count == 0 || value > acc->max) acc->max = value;
+
+    acc->sum += value;
+    acc->count++;
+
+    // Weigh every sample by its sample interval / checkInterval, giving the EWMA a time constant of roughly one display refresh regardless of how often this sensor is read.
+    // Sensors read less often than once per checkInterval have a weight of 1, taking every sample as it is
+    int64_t shifted = (int64_t) value * (1 << ewmaShift);
+    int64_t weight  = (*metricRegistry[index].sampleInterval < config.checkInterval) ? *metricRegistry[index].sampleInterval : config.checkInterval;
+
+    if (acc->ewmaInitialized) acc->ewma += (shifted - acc->ewma) * weight / config.checkInterval;
+        else acc->ewma = shifted;
+
+    acc->ewmaInitialized = true;
+}
+
+
+/**
+ * Overrides the scale & unit of a measurement set in metricRegistry, e.g. when a '/proc/meminfo' key turns out to be a count. Applies from the next emitMeasurements() call on
+ */
+void setMeasurementUnit(enum MeasurementIndex index, uint16_t scale, enum MeasurementUnit unit)
+{
+    unitOverrides[index].scale = scale;
+    unitOverrides[index].unit  = unit;
+}
+
+
+/**
+ * Formats a measurement for displaying it, e.g. "12.3" for 12345 MB. Writes "/" if the measurement has no value yet
+ */
+void formatMeasurement(char *dest, size_t size, enum MeasurementIndex index, const struct Measurement *measurement)
+{
+    if (!measurement->valid)
+    {
+        strncpy(dest, "/", size);
+        return;
+    }
+
+    uint32_t value = (measurement->value < 0) ? 0 : measurement->value; // Cut off noise below 0
+    uint32_t scale = measurement->scale;
+
+    uint8_t decimals = metricRegistry[index].decimals;
+
+    // Values with 3 integer digits are shown without decimals to keep the length fixed. Unscaled values have no decimals
+    if (decimals == 0 || scale == 1 || value >= 100 * scale)
+    {
+        snprintf(dest, size, "%u", (value + scale / 2) / scale);
+        return;
+    }
+
+    // Round to the precision we display, only using integers
+    uint32_t divisor       = scale;
+    uint32_t decimalFactor = 1;
+
+    for (uint8_t i = 0; i < decimals && divisor >= 10; i++)
+    {
+        divisor       /= 10;
+        decimalFactor *= 10;
+    }
+
+    uint32_t rounded = (value + divisor / 2) / divisor;
+
+    if (rounded / decimalFactor >= 100) snprintf(dest, size, "%u", rounded / decimalFactor); // Rounded up to 100
+        else snprintf(dest, size, "%u.%0*u", rounded / decimalFactor, decimals, rounded % decimalFactor);
+}
+
+
+/**
+ * Decimates all samples taken since the last call using the configured sampleAggregation and updates sampledMeasurements. Measurements without new samples keep their value
+ */
+void emitMeasurements()
+{
+    uint64_t now = getMonotonicMs();
+
+    for (int i = 0; i < MEASUREMENT_COUNT; i++)
+    {
+        struct Accumulator *acc = &accumulators[i];
+
+        if (acc->count == 0) continue;
+
+        int32_t value;
+
+        switch (config.sampleAggregation)
+        {
+            case AGGREGATE_MEAN:
+                value = (int32_t) ((acc->sum + acc->count / 2) / acc->count);
+                break;
+            case AGGREGATE_EWMA:
+                value = (int32_t) ((acc->ewma + (1 << (ewmaShift - 1))) >> ewmaShift);
+                break;
+            default:
+                value = acc->max;
+                break;
+        }
+
+        struct Measurement *measurement = &sampledMeasurements.m[i];
+
+        measurement->value     = value;
+        measurement->scale     = (unitOverrides[i].scale > 0) ? unitOverrides[i].scale : metricRegistry[i].scale;
+        measurement->unit      = (unitOverrides[i].scale > 0) ? unitOverrides[i].unit  : metricRegistry[i].unit;
+        measurement->valid     = true;
+        measurement->timestamp = now;
+
+        // Reset window. The EWMA intentionally carries over
+        acc->sum   = 0;
+        acc->count = 0;
+    }
+}
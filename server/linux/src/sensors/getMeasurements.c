@@ -4,10 +4,10 @@
  * Created Date: 2023-01-24 17:40:48
  * Author: 3urobeat
  *
- * Last Modified: 2025-12-16 21:15:19
+ * Last Modified: 2026-10-18 09:31:52
  * Modified By: 3urobeat
  *
- * Copyright (c) 2023 - 2025 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2023 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -18,188 +18,324 @@
 #include "sensors.h"
 
 
-// Stores all current measurements
-struct MeasurementTypes measurements;
+// Persistent data for _getCpuLoad()
+struct CpuCoreStats sampledCpuCoreStats;
 
+struct CpuCoreCounters { // Struct-of-arrays so that the delta pass in _calcCpuCoreLoads() can be vectorized by the compiler
+    uint64_t busy[maxCpuCores + 1];  // Index 0 is the aggregated 'cpu' line, index n + 1 is core 'cpun'
+    uint64_t total[maxCpuCores + 1];
+};
 
-// Persistent data for _getCpuLoad()
-long lastCpuRawNonIdle = 0;
-long lastCpuRawTotal   = 0;
+struct CpuCoreCounters cpuCounters;
+struct CpuCoreCounters lastCpuCounters;
+uint16_t cpuCoreLoads[maxCpuCores + 1]; // in 0.1 %
+bool     cpuCountersInitialized = false;
 
-char getCpuLoadBuffer[64] = "";
+struct CpuTimes cpuTimes;     // Full breakdown of the aggregated 'cpu' line
+struct CpuTimes lastCpuTimes;
+
+char getCpuLoadBuffer[65536] = ""; // Large enough to hold all 'cpu' lines of a machine with maxCpuCores cores
 
 /**
- * Calculates the current CPU utilization
+ * Parses all 'cpu' lines in getCpuLoadBuffer into cpuCounters and cpuTimes. Returns the amount of cores found
  */
-void _getCpuLoad()
+uint32_t _parseCpuCounters()
 {
-    // Read '/proc/stat'
-    getFileContent(getCpuLoadBuffer, sizeof(getCpuLoadBuffer), "/proc/stat", '\n');
+    uint32_t    coreCount = 0;
+    const char *linePtr   = getCpuLoadBuffer;
+
+    struct CpuTimes times;
+
+    while (linePtr[0] == 'c' && linePtr[1] == 'p' && linePtr[2] == 'u')
+    {
+        linePtr += 3;
+
+        // Get index of this line. The aggregated 'cpu' line has no number and is followed by two spaces
+        uint64_t index = 0;
 
-    size_t bytes_read = strlen(getCpuLoadBuffer);
+        if (*linePtr != ' ' && parseNextUint64(&linePtr, &index)) index++;
 
-    getCpuLoadBuffer[bytes_read]     = ' ';  // Replace delimiter (included in result from getdelim()) with a space, so that the last value will be processed in the loop below
-    getCpuLoadBuffer[bytes_read + 1] = '\0'; // Make sure a null byte exists. This should already be the case but maybe I'm stupid
+        if (index > maxCpuCores) break; // Ignore cores we have no space for
 
 
-    // Split procStatContentBuffer at spaces at calc values (rowTitle, user, nice, system, idle, iowait, irq, softirq, steal, guest, guest_nice - see 1.8 @ https://www.kernel.org/doc/Documentation/filesystems/proc.txt)
-    long nonIdle  = 0;
-    long total    = 0;
+        // Parse all columns in place and sum them up. guest is ignored as it is already included in user
+        parseCpuTimes(&linePtr, &times);
 
-    int  matches  = 0; // Zero-Based counter of matches, starting with 'user'
+        uint64_t total = times.user + times.nice + times.system + times.idle + times.iowait + times.irq + times.softirq + times.steal;
+
+        cpuCounters.total[index] = total;
+        cpuCounters.busy[index]  = total - times.idle - times.iowait;
+
+        if (index == 0) cpuTimes = times; // Keep full breakdown of the aggregate line
+            else if (index > coreCount) coreCount = index;
+
+
+        // Go to the next line
+        linePtr = skipToNextLine(linePtr);
+    }
+
+    return coreCount;
+}
 
-    char *valuePtr      = getCpuLoadBuffer + 5; // Point to the start of the first element, skip title column
-    char *valueStartPtr = valuePtr;
 
-    while (*valuePtr) // Behold: A custom implementation for splitting a char array at spaces. I tried dealing with strtok_r() and decided to do it myself.
+/**
+ * Calculates load of the aggregate and every core using the current and previous counters
+ */
+void _calcCpuCoreLoads(uint32_t coreCount)
+{
+    // Delta pass over all cores using integers only. Deltas between two measurements easily fit into 32 bits
+    for (uint32_t i = 0; i <= coreCount; i++)
     {
-        if (*valuePtr == ' ')
-        {
-            *valuePtr = '\0'; // Replace this space with a null-byte. This makes atoi() read from the first char of the current value up until this space (now null-byte)
+        int32_t busyDelta  = (int32_t) (cpuCounters.busy[i]  - lastCpuCounters.busy[i]);
+        int32_t totalDelta = (int32_t) (cpuCounters.total[i] - lastCpuCounters.total[i]);
+
+        int32_t load = (totalDelta > 0 && busyDelta > 0) ? (int32_t) ((int64_t) busyDelta * 1000 / totalDelta) : 0; // Counters of offline cores may jump backwards
+
+        cpuCoreLoads[i] = (load > 1000) ? 1000 : load;
+    }
+
+
+    // Collect max & busiest cores
+    sampledCpuCoreStats.coreCount = coreCount;
+    sampledCpuCoreStats.average   = cpuCoreLoads[0];
+    sampledCpuCoreStats.maxCore   = 0;
+
+    for (int i = 0; i < cpuBusiestCoresAmount; i++)
+    {
+        sampledCpuCoreStats.busiestCores[i] = 0;
+        sampledCpuCoreStats.busiestLoads[i] = -1;
+    }
+
+    for (uint32_t i = 1; i <= coreCount; i++)
+    {
+        int16_t load = cpuCoreLoads[i];
 
-            // Add this value to nonIdle (if not column idle or iowait) and always add to total
-            if (matches != 3 && matches != 4) nonIdle += atoi(valueStartPtr);
-            total += atoi(valueStartPtr);
+        if (load > sampledCpuCoreStats.maxCore) sampledCpuCoreStats.maxCore = load;
 
-            valueStartPtr = valuePtr + 1; // +1 to get "over" space and point to the first char of the next value
-            matches++;
+        // Insert into sorted busiest list if this core is busier than the last entry
+        if (load <= sampledCpuCoreStats.busiestLoads[cpuBusiestCoresAmount - 1]) continue;
+
+        int pos = cpuBusiestCoresAmount - 1;
+
+        while (pos > 0 && load > sampledCpuCoreStats.busiestLoads[pos - 1])
+        {
+            sampledCpuCoreStats.busiestCores[pos] = sampledCpuCoreStats.busiestCores[pos - 1];
+            sampledCpuCoreStats.busiestLoads[pos] = sampledCpuCoreStats.busiestLoads[pos - 1];
+            pos--;
         }
 
-        valuePtr++;
+        sampledCpuCoreStats.busiestCores[pos] = i - 1;
+        sampledCpuCoreStats.busiestLoads[pos] = load;
     }
+}
+
+
+/**
+ * Calculates the current CPU utilization of all cores
+ */
+void _getCpuLoad()
+{
+    // Keep previous counters. Cores missing from this read (e.g. offline) will then report no load instead of garbage
+    memcpy(&lastCpuCounters, &cpuCounters, sizeof(cpuCounters));
+    lastCpuTimes = cpuTimes;
+
+    // Read '/proc/stat'. All 'cpu' lines are at the start of the file
+    getHandleContentFull(getCpuLoadBuffer, sizeof(getCpuLoadBuffer), &sensorHandles.procStat);
+
+    uint32_t coreCount = _parseCpuCounters();
 
 
     // Calculate cpu load using new and previous measurement (if one exists)
-    if (lastCpuRawNonIdle > 0 && lastCpuRawTotal > 0)
+    if (cpuCountersInitialized)
     {
-        float cpuLoad = ((lastCpuRawNonIdle - nonIdle) * 100.0) / (lastCpuRawTotal - total);
-        cpuLoad = abs(round(cpuLoad));          // Round and absolute to remove minus if result is 0.000
+        _calcCpuCoreLoads(coreCount);
+
+        addSample(CPU_LOAD, (config.cpuLoadMode == MAX_CORE) ? sampledCpuCoreStats.maxCore : sampledCpuCoreStats.average);
+
+        // Calculate share of time spent waiting for I/O and stolen by the hypervisor. The iowait counter may jump backwards on NO_HZ kernels, count that as no load
+        int64_t totalDelta  = (int64_t) (cpuCounters.total[0] - lastCpuCounters.total[0]);
+        int64_t iowaitDelta = (int64_t) (cpuTimes.iowait - lastCpuTimes.iowait);
+        int64_t stealDelta  = (int64_t) (cpuTimes.steal  - lastCpuTimes.steal);
 
-        gcvt(cpuLoad, 3, measurements.cpuLoad); // Restrict to 3 digits (0-100%) and write into cpuLoad
+        if (totalDelta > 0)
+        {
+            addSample(CPU_IOWAIT, (iowaitDelta > 0) ? (int32_t) (iowaitDelta * 1000 / totalDelta) : 0);
+            addSample(CPU_STEAL,  (stealDelta > 0)  ? (int32_t) (stealDelta  * 1000 / totalDelta) : 0);
+        }
     }
 
-    // Update lastCpuRawMeasurement with raw data
-    lastCpuRawNonIdle = nonIdle;
-    lastCpuRawTotal   = total;
+    cpuCountersInitialized = true;
 }
 
 
 // Persistent data for _getMemSwapUsage()
-char getMemSwapUsageBuffer[2048] = "";
+int memTotalKey     = -1;
+int memAvailableKey = -1;
+int swapTotalKey    = -1;
+int swapFreeKey     = -1;
+int customKey       = -1; // Key set in config.meminfoMetric, -1 if none is set
 
 /**
  * Processes output from '/proc/meminfo' to get mem & swap usage
  */
 void _getMemSwapUsage()
 {
-    // Read '/proc/meminfo'
-    getFileContentFull(getMemSwapUsageBuffer, sizeof(getMemSwapUsageBuffer), "/proc/meminfo");
+    // Register the keys we are interested in on the first call
+    if (memTotalKey < 0)
+    {
+        memTotalKey     = meminfoRegisterKey("MemTotal");
+        memAvailableKey = meminfoRegisterKey("MemAvailable");
+        swapTotalKey    = meminfoRegisterKey("SwapTotal");
+        swapFreeKey     = meminfoRegisterKey("SwapFree");
 
+        if (config.meminfoMetric[0] != '\0') customKey = meminfoRegisterKey(config.meminfoMetric);
+    }
 
-    // Iterate through rows and find MemTotal, MemAvailable, SwapTotal & SwapFree
-    int memTotal, memAvailable, swapTotal, swapFree;
-    char *lineStartPtr = getMemSwapUsageBuffer;
-    char *bufferPtr    = getMemSwapUsageBuffer;
+    // Read '/proc/meminfo'. Missing keys read as 0
+    updateMeminfo();
 
-    while(*bufferPtr)
-    {
-        if (*bufferPtr == '\n' || *bufferPtr == '\0')
-        {
-            *(bufferPtr - 3) = '\0'; // Place nullbyte in front of 'kB', present at the end of this line. This makes the following functions read from the first char of this line up until the end of the number listed in this line.
-
-            strtok(lineStartPtr, " "); // Cut line into pieces, separated by spaces. After this call, lineStartPtr points to the beginning of the first element, aka the line title.
-
-            // See if this line starts with one of the interesting values
-            if (strStartsWith("MemTotal", lineStartPtr)) {
-                lineStartPtr = strtok(NULL, " "); // Gets the second match, which is our number
-                memTotal = atoi(lineStartPtr);
-            }
-            else if (strStartsWith("MemAvailable", lineStartPtr))
-            {
-                lineStartPtr = strtok(NULL, " ");
-                memAvailable = atoi(lineStartPtr);
-            }
-            else if (strStartsWith("SwapTotal", lineStartPtr))
-            {
-                lineStartPtr = strtok(NULL, " ");
-                swapTotal = atoi(lineStartPtr);
-            }
-            else if (strStartsWith("SwapFree", lineStartPtr))
-            {
-                lineStartPtr = strtok(NULL, " ");
-                swapFree = atoi(lineStartPtr);
-            }
-
-            lineStartPtr = bufferPtr + 1; // +1 to get "over" newline and point to the first char of the next line
-        }
+    uint64_t memTotal     = meminfoGetValue(memTotalKey);
+    uint64_t memAvailable = meminfoGetValue(memAvailableKey);
+    uint64_t swapTotal    = meminfoGetValue(swapTotalKey);
+    uint64_t swapFree     = meminfoGetValue(swapFreeKey);
 
-        bufferPtr++;
-    }
 
+    // Calculate used RAM & Swap and convert from kB to MB
+    int32_t mem  = (memTotal > memAvailable) ? (int32_t) ((memTotal - memAvailable) / 1000) : 0;
+    int32_t swap = (swapTotal > swapFree)    ? (int32_t) ((swapTotal - swapFree)    / 1000) : 0;
 
-    // Calculate used RAM & Swap, convert to GB, format and write into measurements
-    float mem  = (memTotal - memAvailable) / 1000000.0;
-    float swap = (swapTotal - swapFree)    / 1000000.0;
+    addSample(RAM_USAGE, mem);
 
-    floatToFixedLengthStr(measurements.ramUsage, mem);
+    if (swapTotal > 0) addSample(SWAP_USAGE, swap); // Is Swap enabled?
 
-    if (swapTotal > 0) // Is Swap enabled?
+    if (customKey >= 0 && !meminfoHasKey(customKey))
     {
-        if (swap < 0.01) // Do not try to convert values below 10 MB (0.01 GB)
-        {
-            strcpy(measurements.swapUsage, "0.00");
-        }
-        else
-        {
-            floatToFixedLengthStr(measurements.swapUsage, swap);
-        }
+        printf("\033[33mWarn:\033[0m Key '%s' set in meminfoMetric does not exist in '/proc/meminfo'! Ignoring it...\n", config.meminfoMetric);
+        customKey = -1;
+    }
+
+    if (customKey >= 0 && meminfoIsKb(customKey))
+    {
+        addSample(MEMINFO_CUSTOM, (int32_t) (meminfoGetValue(customKey) / 1000));
+    }
+    else if (customKey >= 0) // Counts like 'HugePages_Total' are shown as they are
+    {
+        setMeasurementUnit(MEMINFO_CUSTOM, 1, UNIT_NONE);
+        addSample(MEMINFO_CUSTOM, (int32_t) meminfoGetValue(customKey));
     }
 }
 
 
-// Persistent data for getMeasurements()
+// Persistent data for the samplers below
 char buffer[16] = "";
+uint64_t lastNvidiaSettingsLoadTime = 0;
+uint64_t lastNvidiaSettingsTempTime = 0;
 
 /**
- * Retreives new data and updates measurements
+ * Returns true if nvidia-settings should be spawned again. Spawning it is way too expensive to oversample, so it only runs once per checkInterval
  */
-void getMeasurements()
+bool _nvidiaSettingsDue(uint64_t *lastTime)
 {
-    logDebug("Updating sensor values...");
+    uint64_t now = getMonotonicMs();
+
+    if (*lastTime != 0 && now - *lastTime < (uint64_t) config.checkInterval) return false;
+
+    *lastTime = now;
+    return true;
+}
 
 
-    // Get CPU load & temp
+/**
+ * Samples CPU load, iowait & steal
+ */
+void sampleCpuLoad()
+{
     _getCpuLoad();
+}
+
+
+/**
+ * Samples CPU temperature
+ */
+void sampleCpuTemp()
+{
+    if (sensorPaths.cpuTemp[0] == '\0') return; // Check if a sensor was found before attempting to use it
+
+    getHandleContentFull(buffer, sizeof(buffer), &sensorHandles.cpuTemp);
+    addSample(CPU_TEMP, atoi(buffer) / 100); // Sensors report 50°C as 50000
+}
+
+
+/**
+ * Samples RAM and Swap usage
+ */
+void sampleMemory()
+{
+    _getMemSwapUsage();
+}
+
 
-    if (sensorPaths.cpuTemp[0] != '\0') // Check if a sensor was found before attempting to use it
+/**
+ * Samples GPU load
+ */
+void sampleGpuLoad()
+{
+    if (config.gpuType == NVIDIA && nvmlIsLoaded()) // Query the driver in-process
     {
-        getFileContentFull(buffer, sizeof(buffer), sensorPaths.cpuTemp);
-        gcvt(atoi(buffer) / 1000, 3, measurements.cpuTemp); // Buffer to int, divide by 1000 (sensors report 50°C as 50000), round, restrict to 3 digits (0-100°C) and write into cpuTemp
+        unsigned int value;
+
+        if (nvmlGetGpuLoad(&value)) addSample(GPU_LOAD, value * 10);
     }
+    else if (config.gpuType == NVIDIA) // Fall back to nvidia-settings if NVML is not available
+    {
+        if (!_nvidiaSettingsDue(&lastNvidiaSettingsLoadTime)) return;
 
+        getCmdStdout(buffer, sizeof(buffer), "nvidia-settings -q GPUUtilization -t | awk -F '[,= ]' '{ print $2 }'"); // awk cuts response down to only the graphics parameter
+        addSample(GPU_LOAD, atoi(buffer) * 10);
+    }
+    else if (sensorPaths.gpuLoad[0] != '\0') // Check if a sensor was found before attempting to use it
+    {
+        getHandleContentFull(buffer, sizeof(buffer), &sensorHandles.gpuLoad);
+        addSample(GPU_LOAD, atoi(buffer) * 10); // Sensor 'gpu_busy_percent' returns value straight up like it is
+    }
+}
 
-    // Get RAM and Swap usage
-    _getMemSwapUsage();
 
+/**
+ * Samples GPU temperature
+ */
+void sampleGpuTemp()
+{
+    if (config.gpuType == NVIDIA && nvmlIsLoaded()) // Query the driver in-process
+    {
+        unsigned int value;
 
-    // Get GPU load & temp
-    if (config.gpuType == NVIDIA) // TODO: I do not know yet if Nvidia GPUs can be read through the fs, therefore we're still using the old method here
+        if (nvmlGetGpuTemp(&value)) addSample(GPU_TEMP, value * 10);
+    }
+    else if (config.gpuType == NVIDIA) // Fall back to nvidia-settings if NVML is not available
     {
-        getCmdStdout(measurements.gpuLoad, sizeof(measurements.gpuLoad), "nvidia-settings -q GPUUtilization -t | awk -F '[,= ]' '{ print $2 }'"); // awk cuts response down to only the graphics parameter
+        if (!_nvidiaSettingsDue(&lastNvidiaSettingsTempTime)) return;
 
-        getCmdStdout(measurements.gpuTemp, sizeof(measurements.gpuTemp), "nvidia-settings -q GPUCoreTemp -t");
+        getCmdStdout(buffer, sizeof(buffer), "nvidia-settings -q GPUCoreTemp -t");
+        addSample(GPU_TEMP, atoi(buffer) * 10);
     }
-    else
+    else if (sensorPaths.gpuTemp[0] != '\0') // Check if a sensor was found before attempting to use it
     {
-        if (sensorPaths.gpuLoad[0] != '\0') // Check if a sensor was found before attempting to use it
-        {
-            getFileContentFull(measurements.gpuLoad, sizeof(dataSize), sensorPaths.gpuLoad); // Sensor 'gpu_busy_percent' returns value straight up like it is
-        }
+        getHandleContentFull(buffer, sizeof(buffer), &sensorHandles.gpuTemp);
+        addSample(GPU_TEMP, atoi(buffer) / 100); // Sensors report 50°C as 50000
+    }
+}
 
-        if (sensorPaths.gpuTemp[0] != '\0') // Check if a sensor was found before attempting to use it
-        {
-            getFileContentFull(buffer, sizeof(buffer), sensorPaths.gpuTemp);
-            gcvt(atoi(buffer) / 1000, 3, measurements.gpuTemp); // Buffer to int, divide by 1000 (sensors report 50°C as 50000), round, restrict to 3 digits (0-100°C) and write into cpuTemp
-        }
+
+/**
+ * Retreives new data of all sensors at once and folds it into the accumulators of all measurements. Call emitMeasurements() to update measurements
+ */
+void getMeasurements()
+{
+    logDebug("Updating sensor values...");
+
+    for (int i = 0; i < MEASUREMENT_COUNT; i++)
+    {
+        if (metricRegistry[i].sampler != NULL) metricRegistry[i].sampler();
     }
 }
@@ -4,10 +4,10 @@
  * Created Date: 2024-05-18 13:48:34
  * Author: 3urobeat
  *
- * Last Modified: 2024-10-02 22:27:34
+ * Last Modified: 2026-10-17 22:46:12
  * Modified By: 3urobeat
  *
- * Copyright (c) 2024 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2024 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -24,6 +24,15 @@
 // Stores filesystem paths for all sensors we've found
 struct SensorTypes sensorPaths;
 
+// Stores persistent file handles for all sensors we've found
+struct SensorHandleTypes sensorHandles = {
+    .procStat    = { .fd = -1 },
+    .procMeminfo = { .fd = -1 },
+    .cpuTemp     = { .fd = -1 },
+    .gpuLoad     = { .fd = -1 },
+    .gpuTemp     = { .fd = -1 }
+};
+
 
 /**
  * Checks if a directory exists. Outputs error to stdout if directory could not be opened
@@ -194,7 +203,11 @@ void _findHwmonSensors()
     struct dirent *ep;
     hwmonDirP = opendir(hwmonDirStr);
 
-    if (hwmonDirP == NULL) printf("\033[91mError:\033[0m Failed to open '/sys/class/hwmon/' to probe all sensors!\n");
+    if (hwmonDirP == NULL)
+    {
+        printf("\033[91mError:\033[0m Failed to open '/sys/class/hwmon/' to probe all sensors!\n");
+        return;
+    }
 
 
     // Collect all valid 'hwmon*' directories and check their 'name' files
@@ -277,7 +290,11 @@ void _findThermalZoneSensors()
     struct dirent *ep;
     thermalDirP = opendir(thermalDirStr);
 
-    if (thermalDirP == NULL) printf("\033[91mError:\033[0m Failed to open '/sys/devices/virtual/thermal/' to probe all sensors!\n");
+    if (thermalDirP == NULL)
+    {
+        printf("\033[91mError:\033[0m Failed to open '/sys/devices/virtual/thermal/' to probe all sensors!\n");
+        return;
+    }
 
 
     // Collect all valid 'thermal_zone*' directories and check their 'name' files
@@ -365,22 +382,46 @@ void getSensors()
     }
 
 
+    // Attempt to use NVML instead of spawning nvidia-settings every measurement
+    if (config.gpuType == NVIDIA) nvmlLoad();
+
+
     // Log warnings for missing sensors
     if (strlen(sensorPaths.cpuTemp) == 0)
     {
         printf("\033[33mWarn:\033[0m I could not automatically find any 'CPU Temperature' sensor! If you have one, please configure it manually.\n");
-        strcpy(measurements.cpuTemp, "");
     }
 
     if (strlen(sensorPaths.gpuLoad) == 0 && config.gpuType == AMD)
     {
         printf("\033[33mWarn:\033[0m I could not automatically find any 'GPU Load' sensor! If you have one, please configure it manually.\n");
-        strcpy(measurements.gpuLoad, "");
     }
 
     if (strlen(sensorPaths.gpuTemp) == 0 && config.gpuType == AMD)
     {
         printf("\033[33mWarn:\033[0m I could not automatically find any 'GPU Temperature' sensor! If you have one, please configure it manually.\n");
-        strcpy(measurements.gpuTemp, "");
     }
+
+    // Open all sensors once so that getMeasurements() only needs to re-read them
+    openSensorHandles();
+}
+
+
+/**
+ * Opens persistent file handles for procfs and all sensors that were found. Closes previously opened handles first.
+ */
+void openSensorHandles()
+{
+    fileHandleClose(&sensorHandles.procStat);
+    fileHandleClose(&sensorHandles.procMeminfo);
+    fileHandleClose(&sensorHandles.cpuTemp);
+    fileHandleClose(&sensorHandles.gpuLoad);
+    fileHandleClose(&sensorHandles.gpuTemp);
+
+    fileHandleOpen(&sensorHandles.procStat, "/proc/stat");
+    fileHandleOpen(&sensorHandles.procMeminfo, "/proc/meminfo");
+
+    if (sensorPaths.cpuTemp[0] != '\0') fileHandleOpen(&sensorHandles.cpuTemp, sensorPaths.cpuTemp);
+    if (sensorPaths.gpuLoad[0] != '\0') fileHandleOpen(&sensorHandles.gpuLoad, sensorPaths.gpuLoad);
+    if (sensorPaths.gpuTemp[0] != '\0') fileHandleOpen(&sensorHandles.gpuTemp, sensorPaths.gpuTemp);
 }
@@ -0,0 +1,247 @@
+/*
+ * File: meminfo.c
+ * Project: arduino-resource-monitor
+ * Created Date: 2026-10-17 13:10:26
+ * Author: 3urobeat
+ *
+ * Last Modified: 2026-10-18 09:31:52
+ * Modified By: 3urobeat
+ *
+ * Copyright (c) 2026 3urobeat <https://github.com/3urobeat>
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "sensors.h"
+
+
+#define meminfoMaxKeys       16
+#define meminfoChunkSize     1024
+#define meminfoMaxLineLength 64   // Lines are formatted as '%-15s %8lu kB', this leaves plenty of headroom for long names & huge values
+#define meminfoMaxReadSize   8192 // Learned lines further into the file are read by a full scan every time. '/proc/meminfo' is usually below 2 KB
+
+struct MeminfoKey {
+    char     name[32];
+    size_t   nameLen;
+    off_t    offset; // Offset of this key's line in '/proc/meminfo', -1 if the key does not exist
+    uint64_t value;  // Value in kB or a plain count if the line has no unit, 0 if the key does not exist
+    bool     isKb;   // False for counts like 'HugePages_Total'
+};
+
+
+// Persistent data for updateMeminfo()
+struct MeminfoKey meminfoKeys[meminfoMaxKeys];
+uint32_t meminfoKeysAmount = 0;
+
+bool  meminfoOffsetsLearned = false;
+off_t meminfoReadEnd = 0; // Amount of bytes to read to include all learned lines
+
+char meminfoBuffer[meminfoMaxReadSize + 1] = ""; // Scans only use the first meminfoChunkSize + meminfoMaxLineLength bytes
+
+
+/**
+ * Registers a '/proc/meminfo' key (e.g. 'MemTotal') to be parsed by updateMeminfo(). Returns the index to pass to meminfoGetValue() or -1 if no slot is left.
+ */
+int meminfoRegisterKey(const char *name)
+{
+    // Return existing index if this key was already registered
+    for (uint32_t i = 0; i < meminfoKeysAmount; i++)
+    {
+        if (strcmp(meminfoKeys[i].name, name) == 0) return i;
+    }
+
+    if (meminfoKeysAmount >= meminfoMaxKeys || strlen(name) >= sizeof(meminfoKeys[0].name))
+    {
+        printf("\033[91mError:\033[0m Cannot watch meminfo key '%s', limit of %d keys reached or name too long!\n", name, meminfoMaxKeys);
+        return -1;
+    }
+
+    struct MeminfoKey *key = &meminfoKeys[meminfoKeysAmount];
+
+    strcpy(key->name, name);
+    key->nameLen = strlen(name);
+    key->offset  = -1;
+    key->value   = 0;
+    key->isKb    = false;
+
+    meminfoOffsetsLearned = false; // Force a full scan to find the new key
+
+    return meminfoKeysAmount++;
+}
+
+
+/**
+ * Returns the value of a key registered with meminfoRegisterKey() or 0 if it does not exist. Check meminfoIsKb() for its unit
+ */
+uint64_t meminfoGetValue(int index)
+{
+    if (index < 0 || (uint32_t) index >= meminfoKeysAmount) return 0;
+
+    return meminfoKeys[index].value;
+}
+
+
+/**
+ * Returns true if a key registered with meminfoRegisterKey() exists on this system
+ */
+bool meminfoHasKey(int index)
+{
+    if (index < 0 || (uint32_t) index >= meminfoKeysAmount) return false;
+
+    return meminfoKeys[index].offset >= 0;
+}
+
+
+/**
+ * Returns true if the value of a key registered with meminfoRegisterKey() is in kB, false if it is a plain count or does not exist
+ */
+bool meminfoIsKb(int index)
+{
+    if (index < 0 || (uint32_t) index >= meminfoKeysAmount) return false;
+
+    return meminfoKeys[index].isKb;
+}
+
+
+/**
+ * Checks if the line at linePtr belongs to key and parses its value. linePtr must contain a complete line which ends before endPtr. Returns success
+ */
+bool _parseMeminfoLine(const char *linePtr, const char *endPtr, struct MeminfoKey *key)
+{
+    if (linePtr + key->nameLen + 1 >= endPtr) return false;
+
+    if (memcmp(linePtr, key->name, key->nameLen) != 0 || linePtr[key->nameLen] != ':') return false;
+
+    const char *valuePtr = linePtr + key->nameLen + 1;
+    uint64_t    value    = 0;
+
+    if (!parseNextUint64(&valuePtr, &value) || valuePtr >= endPtr) return false; // Number must not be cut off by the end of the buffer
+
+    // Values are followed by ' kB' unless the key is a count. The unit must not be cut off either
+    while (valuePtr < endPtr && *valuePtr == ' ') valuePtr++;
+
+    if (valuePtr >= endPtr) return false;
+
+    key->value = value;
+    key->isKb  = (*valuePtr == 'k');
+
+    return true;
+}
+
+
+/**
+ * Streams the whole file chunk by chunk, learning the line offset of every registered key. Stops early once all keys were found
+ */
+void _scanMeminfo()
+{
+    logDebug("_scanMeminfo(): Learning line offsets of %u meminfo keys...", meminfoKeysAmount);
+
+    for (uint32_t i = 0; i < meminfoKeysAmount; i++)
+    {
+        meminfoKeys[i].offset = -1;
+        meminfoKeys[i].value  = 0;
+    }
+
+    uint32_t remaining  = meminfoKeysAmount;
+    off_t    fileOffset = 0; // Offset in the file of meminfoBuffer[0]
+    size_t   carry      = 0; // Length of an incomplete line kept at the start of meminfoBuffer from the previous chunk
+
+    while (remaining > 0)
+    {
+        ssize_t bytesRead = fileHandleRead(&sensorHandles.procMeminfo, meminfoBuffer + carry, meminfoChunkSize, fileOffset + carry);
+
+        if (bytesRead <= 0) break; // EOF or error
+
+        char *linePtr = meminfoBuffer;
+        char *endPtr  = meminfoBuffer + carry + bytesRead;
+
+        *endPtr = '\0';
+
+        // Process every complete line in this chunk
+        char *lineEndPtr;
+
+        while (remaining > 0 && (lineEndPtr = memchr(linePtr, '\n', endPtr - linePtr)) != NULL)
+        {
+            for (uint32_t i = 0; i < meminfoKeysAmount; i++)
+            {
+                if (meminfoKeys[i].offset >= 0) continue; // Already found
+
+                if (_parseMeminfoLine(linePtr, lineEndPtr + 1, &meminfoKeys[i]))
+                {
+                    meminfoKeys[i].offset = fileOffset + (linePtr - meminfoBuffer);
+                    remaining--;
+                    break;
+                }
+            }
+
+            linePtr = lineEndPtr + 1;
+        }
+
+        // Move incomplete last line to the start of the buffer so the next chunk completes it. Drop lines that are unexpectedly long
+        carry = endPtr - linePtr;
+
+        if (carry > meminfoMaxLineLength) carry = 0;
+
+        fileOffset += (endPtr - meminfoBuffer) - carry;
+
+        memmove(meminfoBuffer, endPtr - carry, carry);
+    }
+
+
+    // Remember how much we need to read to include all found keys
+    meminfoReadEnd = 0;
+
+    for (uint32_t i = 0; i < meminfoKeysAmount; i++)
+    {
+        if (meminfoKeys[i].offset < 0)
+        {
+            logDebug("_scanMeminfo(): Key '%s' does not exist in '/proc/meminfo'", meminfoKeys[i].name);
+            continue;
+        }
+
+        if (meminfoKeys[i].offset + meminfoMaxLineLength > meminfoReadEnd) meminfoReadEnd = meminfoKeys[i].offset + meminfoMaxLineLength;
+    }
+
+    meminfoOffsetsLearned = true;
+}
+
+
+/**
+ * Reads the file up to the end of the last learned line and re-validates that every key is still at its offset. Returns false if the layout changed
+ */
+bool _readLearnedMeminfo()
+{
+    if (meminfoReadEnd > meminfoMaxReadSize) return false; // Learned lines do not fit into the buffer
+
+    ssize_t bytesRead = fileHandleRead(&sensorHandles.procMeminfo, meminfoBuffer, meminfoReadEnd, 0);
+
+    if (bytesRead <= 0) return false;
+
+    meminfoBuffer[bytesRead] = '\0';
+
+    for (uint32_t i = 0; i < meminfoKeysAmount; i++)
+    {
+        struct MeminfoKey *key = &meminfoKeys[i];
+
+        if (key->offset < 0) continue; // Key does not exist on this system
+
+        if (key->offset >= bytesRead || !_parseMeminfoLine(meminfoBuffer + key->offset, meminfoBuffer + bytesRead, key)) return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * Reads '/proc/meminfo' and updates the values of all registered keys. Files of any size are supported
+ */
+void updateMeminfo()
+{
+    // Fast path: All keys are usually still at the same offset. A value growing by a digit shifts all following lines, in that case learn them again
+    if (meminfoOffsetsLearned && _readLearnedMeminfo()) return;
+
+    _scanMeminfo();
+}
@@ -0,0 +1,159 @@
+/*
+ * File: metricRegistry.c
+ * Project: arduino-resource-monitor
+ * Created Date: 2026-10-17 23:31:08
+ * Author: 3urobeat
+ *
+ * Last Modified: 2026-10-18 09:31:52
+ * Modified By: 3urobeat
+ *
+ * Copyright (c) 2026 3urobeat <https://github.com/3urobeat>
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "sensors.h"
+
+
+// Suffix of every enum MeasurementUnit, as displayed by the client
+const char *unitSuffixes[] = {
+    [UNIT_PERCENT]  = "%",
+    [UNIT_CELSIUS]  = "°C",
+    [UNIT_GIGABYTE] = "GB",
+    [UNIT_NONE]     = ""
+};
+
+
+// Every measurement we know about. Must match the units documented in enum MeasurementIndex.
+// Loads change the fastest and go first under congestion, temperatures overtake everything once they get alarming
+const struct MetricDescriptor metricRegistry[MEASUREMENT_COUNT] = {
+    [CPU_LOAD] = {
+        .name           = "cpuLoad",
+        .label          = "CPU Load",
+        .protocolId     = cpuLoadID,
+        .scale          = 10,
+        .unit           = UNIT_PERCENT,
+        .decimals       = cpuLoadDecimals,
+        .frameScale     = cpuLoadFrameScale,
+        .priority       = 3,
+        .alarmThreshold = 0,
+        .deadband       = &config.deadbands.cpuLoad,
+        .sampleInterval = &config.sampleIntervals.cpuLoad,
+        .sampler        = sampleCpuLoad // Also produces CPU_IOWAIT & CPU_STEAL
+    },
+    [CPU_TEMP] = {
+        .name           = "cpuTemp",
+        .label          = "CPU Temp",
+        .protocolId     = cpuTempID,
+        .scale          = 10,
+        .unit           = UNIT_CELSIUS,
+        .decimals       = cpuTempDecimals,
+        .frameScale     = cpuTempFrameScale,
+        .priority       = 2,
+        .alarmThreshold = 800, // 80 °C
+        .deadband       = &config.deadbands.cpuTemp,
+        .sampleInterval = &config.sampleIntervals.cpuTemp,
+        .sampler        = sampleCpuTemp
+    },
+    [RAM_USAGE] = {
+        .name           = "ramUsage",
+        .label          = "RAM",
+        .protocolId     = ramUsageID,
+        .scale          = 1000,
+        .unit           = UNIT_GIGABYTE,
+        .decimals       = ramUsageDecimals,
+        .frameScale     = ramUsageFrameScale,
+        .priority       = 1,
+        .alarmThreshold = 0,
+        .deadband       = &config.deadbands.ramUsage,
+        .sampleInterval = &config.sampleIntervals.ramUsage,
+        .sampler        = sampleMemory // Also produces SWAP_USAGE & MEMINFO_CUSTOM
+    },
+    [SWAP_USAGE] = {
+        .name           = "swapUsage",
+        .label          = "Swap",
+        .protocolId     = swapUsageID,
+        .scale          = 1000,
+        .unit           = UNIT_GIGABYTE,
+        .decimals       = swapUsageDecimals,
+        .frameScale     = swapUsageFrameScale,
+        .priority       = 0,
+        .alarmThreshold = 0,
+        .deadband       = &config.deadbands.swapUsage,
+        .sampleInterval = &config.sampleIntervals.ramUsage,
+        .sampler        = NULL
+    },
+    [GPU_LOAD] = {
+        .name           = "gpuLoad",
+        .label          = "GPU Load",
+        .protocolId     = gpuLoadID,
+        .scale          = 10,
+        .unit           = UNIT_PERCENT,
+        .decimals       = gpuLoadDecimals,
+        .frameScale     = gpuLoadFrameScale,
+        .priority       = 3,
+        .alarmThreshold = 0,
+        .deadband       = &config.deadbands.gpuLoad,
+        .sampleInterval = &config.sampleIntervals.gpuLoad,
+        .sampler        = sampleGpuLoad
+    },
+    [GPU_TEMP] = {
+        .name           = "gpuTemp",
+        .label          = "GPU Temp",
+        .protocolId     = gpuTempID,
+        .scale          = 10,
+        .unit           = UNIT_CELSIUS,
+        .decimals       = gpuTempDecimals,
+        .frameScale     = gpuTempFrameScale,
+        .priority       = 2,
+        .alarmThreshold = 800, // 80 °C
+        .deadband       = &config.deadbands.gpuTemp,
+        .sampleInterval = &config.sampleIntervals.gpuTemp,
+        .sampler        = sampleGpuTemp
+    },
+    [CPU_IOWAIT] = {
+        .name           = "cpuIowait",
+        .label          = "CPU I/O Wait",
+        .protocolId     = pingID,
+        .scale          = 10,
+        .unit           = UNIT_PERCENT,
+        .decimals       = 1,
+        .frameScale     = 10,
+        .priority       = 0,
+        .alarmThreshold = 0,
+        .deadband       = NULL,
+        .sampleInterval = &config.sampleIntervals.cpuLoad,
+        .sampler        = NULL
+    },
+    [CPU_STEAL] = {
+        .name           = "cpuSteal",
+        .label          = "CPU Steal",
+        .protocolId     = pingID,
+        .scale          = 10,
+        .unit           = UNIT_PERCENT,
+        .decimals       = 1,
+        .frameScale     = 10,
+        .priority       = 0,
+        .alarmThreshold = 0,
+        .deadband       = NULL,
+        .sampleInterval = &config.sampleIntervals.cpuLoad,
+        .sampler        = NULL
+    },
+    [MEMINFO_CUSTOM] = {
+        .name           = "meminfoMetric",
+        .label          = "Meminfo Metric",
+        .protocolId     = pingID,
+        .scale          = 1000,
+        .unit           = UNIT_GIGABYTE,
+        .decimals       = 1,
+        .frameScale     = 10,
+        .priority       = 0,
+        .alarmThreshold = 0,
+        .deadband       = NULL,
+        .sampleInterval = &config.sampleIntervals.ramUsage,
+        .sampler        = NULL
+    }
+};
@@ -0,0 +1,170 @@
+/*
+ * File: nvml.c
+ * Project: arduino-resource-monitor
+ * Created Date: 2026-10-17 14:20:37
+ * Author: 3urobeat
+ *
+ * Last Modified: 2026-10-17 14:52:10
+ * Modified By: 3urobeat
+ *
+ * Copyright (c) 2026 3urobeat <https://github.com/3urobeat>
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "sensors.h"
+
+#include <dlfcn.h>
+
+
+// Minimal subset of nvml.h. We load the library at runtime so that the server does not depend on the Nvidia driver being installed
+#define NVML_SUCCESS         0
+#define NVML_TEMPERATURE_GPU 0
+
+typedef int nvmlReturn_t;
+typedef struct nvmlDevice_st *nvmlDevice_t;
+
+typedef struct {
+    unsigned int gpu;    // Percent of time a kernel was executing on the GPU
+    unsigned int memory; // Percent of time device memory was being read or written
+} nvmlUtilization_t;
+
+// Function table, filled by nvmlLoad()
+struct NvmlFunctions {
+    nvmlReturn_t (*init)(void);
+    nvmlReturn_t (*deviceGetHandleByIndex)(unsigned int index, nvmlDevice_t *device);
+    nvmlReturn_t (*deviceGetUtilizationRates)(nvmlDevice_t device, nvmlUtilization_t *utilization);
+    nvmlReturn_t (*deviceGetTemperature)(nvmlDevice_t device, int sensorType, unsigned int *temp);
+    const char  *(*errorString)(nvmlReturn_t result);
+};
+
+
+// Persistent data for NVML
+void *nvmlLibHandle = NULL;
+struct NvmlFunctions nvml;
+nvmlDevice_t nvmlDevice;
+
+
+/**
+ * Resolves a symbol from the loaded NVML library. Returns NULL and logs an error if it is missing
+ */
+void *_nvmlSymbol(const char *name)
+{
+    void *symbol = dlsym(nvmlLibHandle, name);
+
+    if (!symbol) printf("\033[33mWarn:\033[0m NVML library is missing symbol '%s'!\n", name);
+
+    return symbol;
+}
+
+
+/**
+ * Attempts to load the Nvidia Management Library and open the first GPU. Returns success. On failure, nvidia-settings will be used instead
+ */
+bool nvmlLoad()
+{
+    if (nvmlLibHandle) return true;
+
+    nvmlLibHandle = dlopen("libnvidia-ml.so.1", RTLD_NOW | RTLD_LOCAL);
+
+    if (!nvmlLibHandle) nvmlLibHandle = dlopen("libnvidia-ml.so", RTLD_NOW | RTLD_LOCAL);
+
+    if (!nvmlLibHandle)
+    {
+        printf("\033[33mWarn:\033[0m Failed to load Nvidia Management Library, falling back to 'nvidia-settings'. Error: %s\n", dlerror());
+        return false;
+    }
+
+
+    // Fill function table. Prefer the _v2 variants which are present since driver 325
+    *(void **) &nvml.init                      = _nvmlSymbol("nvmlInit_v2");
+    *(void **) &nvml.deviceGetHandleByIndex    = _nvmlSymbol("nvmlDeviceGetHandleByIndex_v2");
+    *(void **) &nvml.deviceGetUtilizationRates = _nvmlSymbol("nvmlDeviceGetUtilizationRates");
+    *(void **) &nvml.deviceGetTemperature      = _nvmlSymbol("nvmlDeviceGetTemperature");
+    *(void **) &nvml.errorString               = _nvmlSymbol("nvmlErrorString");
+
+    if (!nvml.init || !nvml.deviceGetHandleByIndex || !nvml.deviceGetUtilizationRates || !nvml.deviceGetTemperature || !nvml.errorString)
+    {
+        nvmlUnload();
+        return false;
+    }
+
+
+    // Initialize library and get the first GPU, just like nvidia-settings does by default
+    nvmlReturn_t result = nvml.init();
+
+    if (result == NVML_SUCCESS) result = nvml.deviceGetHandleByIndex(0, &nvmlDevice);
+
+    if (result != NVML_SUCCESS)
+    {
+        printf("\033[33mWarn:\033[0m Failed to initialize Nvidia Management Library, falling back to 'nvidia-settings'. Error: %s\n", nvml.errorString(result));
+        nvmlUnload();
+        return false;
+    }
+
+    printf("\033[92mFound Nvidia GPU using the Nvidia Management Library!\033[0m\n");
+
+    return true;
+}
+
+
+/**
+ * Closes the NVML library and clears the function table
+ */
+void nvmlUnload()
+{
+    if (nvmlLibHandle) (void) dlclose(nvmlLibHandle);
+
+    nvmlLibHandle = NULL;
+    memset(&nvml, 0, sizeof(nvml));
+}
+
+
+/**
+ * Returns whether NVML was loaded successfully and can be used by getMeasurements()
+ */
+bool nvmlIsLoaded()
+{
+    return nvmlLibHandle != NULL;
+}
+
+
+/**
+ * Reads GPU utilization in percent into dest. Returns success
+ */
+bool nvmlGetGpuLoad(unsigned int *dest)
+{
+    nvmlUtilization_t utilization;
+
+    nvmlReturn_t result = nvml.deviceGetUtilizationRates(nvmlDevice, &utilization);
+
+    if (result != NVML_SUCCESS)
+    {
+        logDebug("nvmlGetGpuLoad(): Failed to read utilization: %s", nvml.errorString(result));
+        return false;
+    }
+
+    *dest = utilization.gpu;
+
+    return true;
+}
+
+
+/**
+ * Reads GPU core temperature in °C into dest. Returns success
+ */
+bool nvmlGetGpuTemp(unsigned int *dest)
+{
+    nvmlReturn_t result = nvml.deviceGetTemperature(nvmlDevice, NVML_TEMPERATURE_GPU, dest);
+
+    if (result != NVML_SUCCESS)
+    {
+        logDebug("nvmlGetGpuTemp(): Failed to read temperature: %s", nvml.errorString(result));
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,254 @@
+/*
+ * File: samplerThread.c
+ * Project: arduino-resource-monitor
+ * Created Date: 2026-10-17 18:52:40
+ * Author: 3urobeat
+ *
+ * Last Modified: 2026-10-18 09:56:08
+ * Modified By: 3urobeat
+ *
+ * Copyright (c) 2026 3urobeat <https://github.com/3urobeat>
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "sensors.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+
+// Stores the snapshot last handed to the serial writer
+struct MeasurementStore measurements;
+struct CpuCoreStats     cpuCoreStats;
+
+
+// Seqlock-protected snapshot, written by the sampler thread and read by the main thread.
+// The sequence is odd while the writer is copying, a reader retries if it changed during its copy
+struct MeasurementSnapshot {
+    uint32_t                sequence;
+    struct MeasurementStore measurements;
+    struct CpuCoreStats     cpuCoreStats;
+};
+
+struct MeasurementSnapshot snapshot;
+
+// Hand-off statistics. Each field is only written by one thread and accessed atomically
+struct SnapshotStats {
+    uint64_t published;     // Snapshots written by the sampler thread
+    uint64_t consumed;      // Snapshots read by the main thread
+    uint64_t overwritten;   // Snapshots replaced before the main thread read them, e.g. because a serial write blocked
+    uint64_t readRetries;   // Reads repeated because the sampler thread was writing at the same time
+};
+
+struct SnapshotStats snapshotStats;
+
+uint32_t consumedSequence = 0; // Sequence of the snapshot the main thread read last
+
+
+// Persistent data for the sampler thread
+pthread_t samplerThread;
+bool      samplerThreadRunning = false;
+
+int samplerEpollFd  = -1;
+int snapshotEventFd = -1; // Signals the main thread that a new snapshot was published
+int stopEventFd     = -1; // Signals the sampler thread to exit
+
+struct TickScheduler scheduler; // Runs every sampler at its own interval and publishes every checkInterval ms
+
+struct TickTask samplerTasks[MEASUREMENT_COUNT]; // Indexed like metricRegistry, only used for entries with a sampler
+struct TickTask publishTask;
+
+
+/**
+ * Combines all samples and publishes them as a new snapshot. Never blocks, a snapshot the main thread did not read yet is overwritten
+ */
+void _publishMeasurements()
+{
+    emitMeasurements();
+
+    uint32_t sequence = snapshot.sequence; // Only this thread writes the sequence
+
+    if (snapshotStats.published > 0 && __atomic_load_n(&consumedSequence, __ATOMIC_RELAXED) != sequence)
+    {
+        __atomic_add_fetch(&snapshotStats.overwritten, 1, __ATOMIC_RELAXED);
+    }
+
+    // Mark snapshot as being written, copy and mark it as complete again
+    __atomic_store_n(&snapshot.sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy(&snapshot.measurements, &sampledMeasurements, sizeof(snapshot.measurements));
+    memcpy(&snapshot.cpuCoreStats, &sampledCpuCoreStats, sizeof(snapshot.cpuCoreStats));
+
+    __atomic_store_n(&snapshot.sequence, sequence + 2, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&snapshotStats.published, 1, __ATOMIC_RELAXED);
+
+    // Wake up the main thread
+    uint64_t one = 1;
+
+    if (write(snapshotEventFd, &one, sizeof(one)) != sizeof(one))
+    {
+        logDebug("_publishMeasurements: Failed to notify main thread: %s", strerror(errno));
+    }
+}
+
+
+/**
+ * Runs the tick scheduler until stopSamplerThread() is called
+ */
+void *_samplerThreadLoop(void *arg)
+{
+    (void) arg;
+
+    while (true)
+    {
+        struct epoll_event events[2];
+
+        int eventsAmount = epoll_wait(samplerEpollFd, events, 2, -1);
+
+        if (eventsAmount < 0 && errno != EINTR)
+        {
+            printf("\033[91mError:\033[0m Sampler thread failed to wait for events! Error: %s\n", strerror(errno));
+            exit(1);
+        }
+
+        for (int i = 0; i < eventsAmount; i++)
+        {
+            if (events[i].data.fd == stopEventFd) return NULL;
+
+            if (events[i].data.fd == scheduler.fd) tickSchedulerHandle(&scheduler);
+        }
+    }
+}
+
+
+/**
+ * Starts the thread sampling all sensors & publishing snapshots. Block signals before calling this so that they are delivered to the main thread. Returns success
+ */
+bool startSamplerThread()
+{
+    if (samplerThreadRunning) return true;
+
+    samplerEpollFd  = epoll_create1(EPOLL_CLOEXEC);
+    snapshotEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    stopEventFd     = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    // Timers. Every sampler in the registry gets its own task, the publish task is added last so that it runs after all samplers due at the same time
+    bool schedulerCreated = tickSchedulerInit(&scheduler);
+
+    for (int i = 0; i < MEASUREMENT_COUNT && schedulerCreated; i++)
+    {
+        const struct MetricDescriptor *metric = &metricRegistry[i];
+
+        if (metric->sampler == NULL) continue;
+
+        if (*metric->sampleInterval > config.checkInterval) metric->sampler(); // Read sensors sampled less often than once per checkInterval now, otherwise the first snapshots would lack them
+
+        schedulerCreated = tickSchedulerAddTask(&scheduler, &samplerTasks[i], metric->name, *metric->sampleInterval, metric->sampler);
+    }
+
+    schedulerCreated = schedulerCreated && tickSchedulerAddTask(&scheduler, &publishTask, "publish", config.checkInterval, _publishMeasurements);
+
+    if (samplerEpollFd < 0 || snapshotEventFd < 0 || stopEventFd < 0 || !schedulerCreated) return false;
+
+    struct epoll_event event = { .events = EPOLLIN };
+
+    event.data.fd = scheduler.fd;
+    epoll_ctl(samplerEpollFd, EPOLL_CTL_ADD, scheduler.fd, &event);
+
+    event.data.fd = stopEventFd;
+    epoll_ctl(samplerEpollFd, EPOLL_CTL_ADD, stopEventFd, &event);
+
+    // Start thread
+    int err = pthread_create(&samplerThread, NULL, _samplerThreadLoop, NULL);
+
+    if (err != 0)
+    {
+        errno = err;
+        return false;
+    }
+
+    samplerThreadRunning = true;
+    return true;
+}
+
+
+/**
+ * Stops the sampler thread and waits for it to exit
+ */
+void stopSamplerThread()
+{
+    if (!samplerThreadRunning) return;
+
+    uint64_t one = 1;
+
+    if (write(stopEventFd, &one, sizeof(one)) == sizeof(one)) pthread_join(samplerThread, NULL);
+
+    samplerThreadRunning = false;
+}
+
+
+/**
+ * Returns a file descriptor which becomes readable when a new snapshot was published. Add it to your event loop
+ */
+int samplerGetEventFd()
+{
+    return snapshotEventFd;
+}
+
+
+/**
+ * Copies the latest snapshot into measurements & cpuCoreStats and clears the eventfd. Returns false if no new snapshot was published since the last call
+ */
+bool consumeMeasurements()
+{
+    uint64_t counter;
+
+    if (read(snapshotEventFd, &counter, sizeof(counter)) != sizeof(counter)) counter = 0; // Not an error, multiple notifications are merged into one read
+
+    uint32_t before;
+
+    while (true)
+    {
+        before = __atomic_load_n(&snapshot.sequence, __ATOMIC_ACQUIRE);
+
+        if ((before & 1) == 0)
+        {
+            memcpy(&measurements, &snapshot.measurements, sizeof(measurements));
+            memcpy(&cpuCoreStats, &snapshot.cpuCoreStats, sizeof(cpuCoreStats));
+
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+            if (__atomic_load_n(&snapshot.sequence, __ATOMIC_RELAXED) == before) break;
+        }
+
+        __atomic_add_fetch(&snapshotStats.readRetries, 1, __ATOMIC_RELAXED);
+    }
+
+    if (before == consumedSequence) return false;
+
+    __atomic_store_n(&consumedSequence, before, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&snapshotStats.consumed, 1, __ATOMIC_RELAXED);
+
+    return true;
+}
+
+
+/**
+ * Prints hand-off statistics to stdout. Also prints scheduler stats if the sampler thread was stopped
+ */
+void samplerPrintStats()
+{
+    printf("Snapshots: %" PRIu64 " published, %" PRIu64 " consumed, %" PRIu64 " overwritten, %" PRIu64 " read retries\n",
+           __atomic_load_n(&snapshotStats.published, __ATOMIC_RELAXED),
+           __atomic_load_n(&snapshotStats.consumed, __ATOMIC_RELAXED),
+           __atomic_load_n(&snapshotStats.overwritten, __ATOMIC_RELAXED),
+           __atomic_load_n(&snapshotStats.readRetries, __ATOMIC_RELAXED));
+
+    if (!samplerThreadRunning) tickSchedulerPrintStats(&scheduler);
+}
@@ -4,10 +4,10 @@
  * Created Date: 2024-05-26 14:06:27
  * Author: 3urobeat
  *
- * Last Modified: 2024-05-26 14:17:32
+ * Last Modified: 2026-10-18 09:31:52
  * Modified By: 3urobeat
  *
- * Copyright (c) 2024 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2024 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -20,19 +20,82 @@
 #include "../server.h"
 
 
-// Stores all current measurements
-#define dataSize 8
+// Index of every measurement, used to address its accumulator and its entry in metricRegistry. Samples must be passed to addSample() in the unit noted here
+enum MeasurementIndex {
+    CPU_LOAD = 0, // in 0.1 %
+    CPU_TEMP,     // in 0.1 °C
+    RAM_USAGE,    // in MB
+    SWAP_USAGE,   // in MB
+    GPU_LOAD,     // in 0.1 %
+    GPU_TEMP,     // in 0.1 °C
+    CPU_IOWAIT,   // in 0.1 %, not displayed by the client yet
+    CPU_STEAL,    // in 0.1 %, not displayed by the client yet
+    MEMINFO_CUSTOM, // in MB or as count if the key has no unit, '/proc/meminfo' key set in config.meminfoMetric. Not displayed by the client yet
+    MEASUREMENT_COUNT
+};
+
+enum MeasurementUnit {
+    UNIT_PERCENT = 0,
+    UNIT_CELSIUS,
+    UNIT_GIGABYTE,
+    UNIT_NONE
+};
+
+// Stores a measurement as scaled integer so that sampling, comparing and sending never needs floats. Only formatted when displayed
+struct Measurement {
+    int32_t  value;     // Real value is value / scale
+    uint16_t scale;
+    uint8_t  unit;      // enum MeasurementUnit
+    bool     valid;     // False until the first value was emitted
+    uint64_t timestamp; // CLOCK_MONOTONIC ms of the emit that produced this value
+};
+
+struct MeasurementStore {
+    struct Measurement m[MEASUREMENT_COUNT];
+};
+
+extern struct MeasurementStore measurements;        // Last snapshot handed to the serial writer. Only accessed by the main thread
+extern struct MeasurementStore sampledMeasurements; // Written by emitMeasurements(). Only accessed by the sampler thread
+
+#define dataSize 8 // Max length of a formatted measurement
+
+
+// Describes every measurement. Sampling, change detection, sending and logging iterate over this table, so adding a metric only needs a new entry and a sampler
+struct MetricDescriptor {
+    const char              *name;           // Used for sampler task names
+    const char              *label;          // Used when logging
+    MeasurementPrefixIDsType protocolId;     // Sent to the client with this ID from protocolSchema.h. pingID if the client does not display it
+    uint16_t                 scale;          // Stored value is real value * scale
+    enum MeasurementUnit     unit;
+    uint8_t                  decimals;       // Shown below 100, values with 3 integer digits are always shown without decimals. Taken from protocolSchema.h for sent metrics
+    uint16_t                 frameScale;     // Value is converted to this scale and sent as integer in frames. Taken from protocolSchema.h for sent metrics
+    uint8_t                  priority;       // Queued measurements with a higher priority are sent first when the link is congested
+    int32_t                  alarmThreshold; // Values at or above this (in the stored scale) are sent before everything else. 0 to disable
+    const float             *deadband;       // Config entry in the real unit, NULL if any change should be sent
+    const int               *sampleInterval; // Config entry in ms
+    void                   (*sampler)();     // Samples this and possibly other measurements. NULL if the sampler of another entry produces it
+};
 
-struct MeasurementTypes {
-    char cpuLoad[dataSize];
-    char cpuTemp[dataSize];
-    char ramUsage[dataSize];
-    char swapUsage[dataSize];
-    char gpuLoad[dataSize];
-    char gpuTemp[dataSize];
+#define alarmPriority 1000 // Priority of measurements above their alarmThreshold
+
+extern const struct MetricDescriptor metricRegistry[MEASUREMENT_COUNT];
+extern const char *unitSuffixes[];
+
+
+// Stores per-core CPU load statistics of the last measurement
+#define maxCpuCores 512
+#define cpuBusiestCoresAmount 4
+
+struct CpuCoreStats { // All loads in 0.1 %
+    uint32_t coreCount;
+    uint16_t average;                                // Load of all cores combined
+    uint16_t maxCore;                                // Load of the busiest core
+    uint16_t busiestCores[cpuBusiestCoresAmount];    // Core numbers of the busiest cores, sorted descending
+    int16_t  busiestLoads[cpuBusiestCoresAmount];    // -1 if there are less cores
 };
 
-extern struct MeasurementTypes measurements;
+extern struct CpuCoreStats cpuCoreStats;        // Last snapshot handed to the serial writer. Only accessed by the main thread
+extern struct CpuCoreStats sampledCpuCoreStats; // Only accessed by the sampler thread
 
 
 // Stores filesystem paths for all sensors we've found
@@ -47,7 +110,48 @@ struct SensorTypes {
 extern struct SensorTypes sensorPaths;
 
 
+// Stores persistent file handles for all files read during getMeasurements()
+struct SensorHandleTypes {
+    struct FileHandle procStat;
+    struct FileHandle procMeminfo;
+    struct FileHandle cpuTemp;
+    struct FileHandle gpuLoad;
+    struct FileHandle gpuTemp;
+};
+
+extern struct SensorHandleTypes sensorHandles;
+
+
 // Functions to export
 extern void getMeasurements();
+extern void sampleCpuLoad();
+extern void sampleCpuTemp();
+extern void sampleMemory();
+extern void sampleGpuLoad();
+extern void sampleGpuTemp();
+
+extern void addSample(enum MeasurementIndex index, int32_t value);
+extern void emitMeasurements();
+extern void setMeasurementUnit(enum MeasurementIndex index, uint16_t scale, enum MeasurementUnit unit);
+extern void formatMeasurement(char *dest, size_t size, enum MeasurementIndex index, const struct Measurement *measurement);
+
+extern int  meminfoRegisterKey(const char *name);
+extern uint64_t meminfoGetValue(int index);
+extern bool meminfoHasKey(int index);
+extern bool meminfoIsKb(int index);
+extern void updateMeminfo();
+
+extern bool nvmlLoad();
+extern void nvmlUnload();
+extern bool nvmlIsLoaded();
+extern bool nvmlGetGpuLoad(unsigned int *dest);
+extern bool nvmlGetGpuTemp(unsigned int *dest);
+
+extern bool startSamplerThread();
+extern void stopSamplerThread();
+extern int  samplerGetEventFd();
+extern bool consumeMeasurements();
+extern void samplerPrintStats();
 
 extern void getSensors();
+extern void openSensorHandles();
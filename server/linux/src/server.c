@@ -4,10 +4,10 @@
  * Created Date: 2022-02-04 20:47:18
  * Author: 3urobeat
  *
- * Last Modified: 2025-12-16 18:04:53
+ * Last Modified: 2026-10-18 09:56:08
  * Modified By: 3urobeat
  *
- * Copyright (c) 2022 - 2025 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2022 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -21,6 +21,35 @@
 int connectionRetry = 0;
 
 
+/**
+ * Replaces unset per-sensor sample intervals with sampleInterval and raises them to the minimum sampleInterval is allowed to have.
+ * Intervals above checkInterval are allowed, the last value is then shown until the sensor is read again
+ */
+void _validateSampleIntervals()
+{
+    struct { const char *name; int *value; } intervals[] = {
+        { "cpuLoad",  &config.sampleIntervals.cpuLoad },
+        { "cpuTemp",  &config.sampleIntervals.cpuTemp },
+        { "ramUsage", &config.sampleIntervals.ramUsage },
+        { "gpuLoad",  &config.sampleIntervals.gpuLoad },
+        { "gpuTemp",  &config.sampleIntervals.gpuTemp }
+    };
+
+    for (size_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++)
+    {
+        int *value = intervals[i].value;
+
+        if (*value == 0) *value = config.sampleInterval;
+
+        if (*value < 50)
+        {
+            printf("\033[33mWarn:\033[0m Sample interval '%s' is too low, using 50ms instead.\n", intervals[i].name);
+            *value = 50;
+        }
+    }
+}
+
+
 // Entry point
 int main()
 {
@@ -41,6 +70,20 @@ int main()
         exit(1);
     }
 
+    if (config.sampleInterval < 50)
+    {
+        printf("\033[91mError:\033[0m Setting sampleInterval is too low! Please set it to at least 50!\n");
+        exit(1);
+    }
+
+    if (config.sampleInterval > config.checkInterval)
+    {
+        printf("\033[33mWarn:\033[0m Setting sampleInterval is higher than checkInterval, using %dms instead.\n", config.checkInterval);
+        config.sampleInterval = config.checkInterval;
+    }
+
+    _validateSampleIntervals();
+
 
     // Attempt to find sensors
     getSensors();
@@ -51,34 +94,141 @@ int main()
 }
 
 
+// Persistent data for dataLoop(). Created once and reused on reconnect
+int epollFd  = -1;
+int signalFd = -1;
+
+/**
+ * Creates the epoll set with the sampler thread's snapshot notifications and a signalfd for SIGINT & SIGTERM
+ */
+void _setupEventLoop()
+{
+    if (epollFd >= 0) return;
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+    // Receive termination signals through a file descriptor instead of interrupting us somewhere random. Blocked before starting the sampler thread so that it inherits the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    // Sample sensors on their own thread so that slow serial writes can't delay them
+    bool samplerStarted = startSamplerThread();
+
+    if (epollFd < 0 || signalFd < 0 || !samplerStarted)
+    {
+        printf("\033[91mError:\033[0m Failed to set up event loop! Error: %s\n", strerror(errno));
+        exit(1);
+    }
+
+    struct epoll_event event = { .events = EPOLLIN };
+
+    event.data.fd = samplerGetEventFd();
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, event.data.fd, &event);
+
+    event.data.fd = signalFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event);
+
+#if !clientLessMode
+    // Wakes us up when queued messages can be sent to the client
+    event.data.fd = sendGetTimerFd();
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, event.data.fd, &event);
+#endif
+}
+
+
+/**
+ * Handles a termination signal by closing the connection and exiting
+ */
+void _handleSignal()
+{
+    struct signalfd_siginfo info;
+
+    if (read(signalFd, &info, sizeof(info)) != sizeof(info)) return;
+
+    printf("\nReceived signal %d, closing connection and exiting...\n", info.ssi_signo);
+
+    stopSamplerThread();
+    samplerPrintStats();
+    linkPrintStats();
+
+    serialClose();
+    exit(0);
+}
+
+
 // Handles refreshing measurements and sending them to the Arduino
 void dataLoop()
 {
     printf("\nStarting to send data...\n");
 
-    strcpy(measurements.cpuLoad, "/"); // Init with '/' because it takes 2 measurements to display
+    _setupEventLoop();
 
 #if !clientLessMode
-    while (serialIsOpen()) // Run intervalEvent() every checkInterval ms as long as connection is not NULL
-    {
-        // Check if client sent something into our serial buffer
-        checkForClientInterrupt();
+    // Wake up as soon as the client sends something. The fd is removed from the set automatically when the connection is closed
+    struct epoll_event serialEvent = { .events = EPOLLIN | EPOLLRDHUP };
+    serialEvent.data.fd = serialGetFd();
+
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, serialEvent.data.fd, &serialEvent);
 
-        // Get current measurements and send them to the client
-        getMeasurements();
+    // Send the whole state right away if we already have measurements, e.g. after a reconnect. Otherwise it is sent with the first snapshot
+    sendMeasurements();
 
-        sendMeasurements();
+    while (serialIsOpen()) // Send results every checkInterval ms as long as connection is not NULL
 #else
-    while(true) // Run forever until process is manually terminated
+    while (true) // Run forever until process is manually terminated
+#endif
     {
-        // Get current measurements and log them to stdout
-        getMeasurements();
+        struct epoll_event events[4];
 
-        logMeasurements();
-#endif
+        int eventsAmount = epoll_wait(epollFd, events, 4, -1);
 
-        // Delay for checkInterval ms
-        usleep(config.checkInterval * 1000);
+        if (eventsAmount < 0 && errno != EINTR)
+        {
+            printf("\033[91mError:\033[0m Failed to wait for events! Error: %s\n", strerror(errno));
+            exit(1);
+        }
+
+        for (int i = 0; i < eventsAmount; i++)
+        {
+            int fd = events[i].data.fd;
+
+            if (fd == signalFd) _handleSignal();
+
+            // Send the latest snapshot to the client or log it to stdout
+            if (fd == samplerGetEventFd() && consumeMeasurements())
+            {
+            #if !clientLessMode
+                sendMeasurements();
+            #else
+                logMeasurements();
+            #endif
+            }
+
+        #if !clientLessMode
+            if (fd == serialEvent.data.fd)
+            {
+                // Device was unplugged or the connection broke
+                if (events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP))
+                {
+                    printf("\033[91mError:\033[0m Lost connection to device!\n");
+                    reconnect();
+                    return;
+                }
+
+                // Handle any messages the client sent us. They may contain credits, so send what is queued afterwards
+                handleClientMessages();
+
+                if (serialIsOpen()) flushSendQueue();
+            }
+
+            if (fd == sendGetTimerFd()) flushSendQueue();
+        #endif
+        }
     }
 }
 
@@ -128,12 +278,13 @@ void connect()
 // Closes connection to the device and attempts to reconnect
 void reconnect()
 {
-    printf("\nAttempting to reconnect in 5 seconds...\n");
+    printf("\nAttempting to reconnect...\n");
 
-    // Close connection if still open
-    serialClose();
+    samplerPrintStats();
+    linkPrintStats();
 
-    sleep(5);
+    // Close connection if still open
+    serialClose(); // makeConnection() waits for the last used port to re-appear if it is gone, e.g. during a USB hiccup
 
     // Reset connection tries
     connectionRetry = 0;
@@ -4,10 +4,10 @@
  * Created Date: 2023-01-24 17:56:00
  * Author: 3urobeat
  *
- * Last Modified: 2024-06-04 18:03:35
+ * Last Modified: 2026-10-18 00:14:37
  * Modified By: 3urobeat
  *
- * Copyright (c) 2023 - 2024 3urobeat <https://github.com/3urobeat>
+ * Copyright (c) 2023 - 2026 3urobeat <https://github.com/3urobeat>
  *
  * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
  * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
@@ -28,9 +28,15 @@
 #include <unistd.h>  // sleep, usleep
 #include <time.h>    // clock
 #include <math.h>    // round
+#include <signal.h>  // sigaddset, ...
+#include <pthread.h> // pthread_create, pthread_sigmask
+#include <sys/epoll.h>    // epoll_create1, epoll_wait, ...
+#include <sys/timerfd.h>  // timerfd_create, ...
+#include <sys/signalfd.h> // signalfd
 
 
 // Include project headers
+#include "protocolSchema.h" // Shared with the client
 #include "comm/comm.h"
 #include "data/data.h"
 #include "helpers/helpers.h"
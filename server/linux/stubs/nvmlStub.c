@@ -0,0 +1,133 @@
+/*
+ * File: nvmlStub.c
+ * Project: arduino-resource-monitor
+ * Created Date: 2026-10-18 09:41:17
+ * Author: 3urobeat
+ *
+ * Last Modified: 2026-10-18 09:41:17
+ * Modified By: 3urobeat
+ *
+ * Copyright (c) 2026 3urobeat <https://github.com/3urobeat>
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// Fake libnvidia-ml.so.1 exporting only the symbols sensors/nvml.c resolves. Lets the NVML path be run on machines without an Nvidia driver
+// Behavior is controlled through environment variables:
+//   NVML_STUB_GPU_LOAD:   Reported GPU utilization in %, default 42
+//   NVML_STUB_GPU_TEMP:   Reported GPU temperature in °C, default 55
+//   NVML_STUB_INIT_ERROR: Return code of nvmlInit_v2(), e.g. 9 (driver not loaded) to test the nvidia-settings fallback. Default 0
+//   NVML_STUB_READ_ERROR: Return code of every read, e.g. 15 (GPU is lost). Default 0
+
+#include <stdlib.h>
+
+
+#define NVML_SUCCESS                 0
+#define NVML_ERROR_UNINITIALIZED     1
+#define NVML_ERROR_INVALID_ARGUMENT  2
+#define NVML_ERROR_NOT_SUPPORTED     3
+#define NVML_ERROR_DRIVER_NOT_LOADED 9
+#define NVML_ERROR_GPU_IS_LOST       15
+
+typedef int nvmlReturn_t;
+typedef struct nvmlDevice_st *nvmlDevice_t;
+
+typedef struct {
+    unsigned int gpu;
+    unsigned int memory;
+} nvmlUtilization_t;
+
+
+// Persistent data of the fake device
+int stubInitialized = 0;
+int stubDevice      = 0; // Only its address is handed out as device handle
+
+
+/**
+ * Returns the value of an environment variable as integer or fallback if it is not set
+ */
+int _stubGetEnv(const char *name, int fallback)
+{
+    const char *value = getenv(name);
+
+    return (value && value[0] != '\0') ? atoi(value) : fallback;
+}
+
+
+nvmlReturn_t nvmlInit_v2(void)
+{
+    nvmlReturn_t result = _stubGetEnv("NVML_STUB_INIT_ERROR", NVML_SUCCESS);
+
+    if (result == NVML_SUCCESS) stubInitialized = 1;
+
+    return result;
+}
+
+
+nvmlReturn_t nvmlShutdown(void)
+{
+    stubInitialized = 0;
+
+    return NVML_SUCCESS;
+}
+
+
+nvmlReturn_t nvmlDeviceGetHandleByIndex_v2(unsigned int index, nvmlDevice_t *device)
+{
+    if (!stubInitialized) return NVML_ERROR_UNINITIALIZED;
+    if (index != 0 || !device) return NVML_ERROR_INVALID_ARGUMENT; // Only one GPU exists
+
+    *device = (nvmlDevice_t) &stubDevice;
+
+    return NVML_SUCCESS;
+}
+
+
+nvmlReturn_t nvmlDeviceGetUtilizationRates(nvmlDevice_t device, nvmlUtilization_t *utilization)
+{
+    if (!stubInitialized) return NVML_ERROR_UNINITIALIZED;
+    if (device != (nvmlDevice_t) &stubDevice || !utilization) return NVML_ERROR_INVALID_ARGUMENT;
+
+    nvmlReturn_t result = _stubGetEnv("NVML_STUB_READ_ERROR", NVML_SUCCESS);
+
+    if (result != NVML_SUCCESS) return result;
+
+    utilization->gpu    = _stubGetEnv("NVML_STUB_GPU_LOAD", 42);
+    utilization->memory = 0;
+
+    return NVML_SUCCESS;
+}
+
+
+nvmlReturn_t nvmlDeviceGetTemperature(nvmlDevice_t device, int sensorType, unsigned int *temp)
+{
+    if (!stubInitialized) return NVML_ERROR_UNINITIALIZED;
+    if (device != (nvmlDevice_t) &stubDevice || !temp) return NVML_ERROR_INVALID_ARGUMENT;
+    if (sensorType != 0) return NVML_ERROR_NOT_SUPPORTED; // Only NVML_TEMPERATURE_GPU exists
+
+    nvmlReturn_t result = _stubGetEnv("NVML_STUB_READ_ERROR", NVML_SUCCESS);
+
+    if (result != NVML_SUCCESS) return result;
+
+    *temp = _stubGetEnv("NVML_STUB_GPU_TEMP", 55);
+
+    return NVML_SUCCESS;
+}
+
+
+const char *nvmlErrorString(nvmlReturn_t result)
+{
+    switch (result)
+    {
+        case NVML_SUCCESS:                 return "Success";
+        case NVML_ERROR_UNINITIALIZED:     return "Uninitialized";
+        case NVML_ERROR_INVALID_ARGUMENT:  return "Invalid Argument";
+        case NVML_ERROR_NOT_SUPPORTED:     return "Not Supported";
+        case NVML_ERROR_DRIVER_NOT_LOADED: return "Driver Not Loaded";
+        case NVML_ERROR_GPU_IS_LOST:       return "GPU is lost";
+        default:                           return "Stub Error";
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * File: protocolSchema.h
+ * Project: arduino-resource-monitor
+ * Created Date: 2026-10-18 00:14:37
+ * Author: 3urobeat
+ *
+ * Last Modified: 2026-10-18 10:14:29
+ * Modified By: 3urobeat
+ *
+ * Copyright (c) 2026 3urobeat <https://github.com/3urobeat>
+ *
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// Wire protocol between server and client. Included by both, so a change here always applies to both sides.
+// Must stay plain C99 preprocessor definitions, the client is compiled by avr-gcc.
+
+#pragma once
+
+
+// Every measurement field the client can display: X(name, id, frameScale, decimals, unit)
+//   name       - Used to derive <name>ID, <name>FrameScale, ... and the register of the client
+//   id         - Prefix of text messages and frame fields (min 1, max 127 because of frameInvalidFlag). 0 is reserved for pingID
+//   frameScale - Frame fields carry the real value multiplied by this as uint16
+//   decimals   - Decimals shown for values below 100 (0 or 1). frameScale must be 10 if this is 1 so that frames carry them
+//   unit       - Suffix the client appends, at most 3 bytes
+#define PROTOCOL_FIELDS(X)        \
+    X(cpuLoad,   1, 1,  0, "%")   \
+    X(cpuTemp,   2, 1,  0, "°C")  \
+    X(ramUsage,  3, 10, 1, "GB")  \
+    X(swapUsage, 4, 10, 1, "GB")  \
+    X(gpuLoad,   5, 1,  0, "%")   \
+    X(gpuTemp,   6, 1,  0, "°C")
+
+// Highest id used above, decode tables are indexed by id. Derived from the largest member of a union with one char[id] per field, so it never needs to be maintained by hand
+#define PROTOCOL_MAX_ID_ENTRY(name, id, frameScale, decimals, unit) char name[id];
+
+union ProtocolMaxId {
+    PROTOCOL_FIELDS(PROTOCOL_MAX_ID_ENTRY)
+};
+
+#define protocolMaxId ((int) sizeof(union ProtocolMaxId))
+
+
+// IDs of all data messages, e.g. cpuLoadID
+#define PROTOCOL_ID_ENTRY(name, id, frameScale, decimals, unit) name##ID = id,
+
+typedef enum {
+    pingID = 0, // Empty data message only used by server for preventing connection loss screen
+    PROTOCOL_FIELDS(PROTOCOL_ID_ENTRY)
+} MeasurementPrefixIDsType;
+
+// Frame scale of all fields, e.g. ramUsageFrameScale
+#define PROTOCOL_FRAME_SCALE_ENTRY(name, id, frameScale, decimals, unit) name##FrameScale = frameScale,
+
+enum ProtocolFrameScales {
+    PROTOCOL_FIELDS(PROTOCOL_FRAME_SCALE_ENTRY)
+};
+
+// Decimals of all fields, e.g. ramUsageDecimals
+#define PROTOCOL_DECIMALS_ENTRY(name, id, frameScale, decimals, unit) name##Decimals = decimals,
+
+enum ProtocolDecimals {
+    PROTOCOL_FIELDS(PROTOCOL_DECIMALS_ENTRY)
+};
+
+
+// Binary frame protocol. Advertised by appending frameCapability to the server's handshake header, used if the client echoes it back.
+// A frame looks like this: frameStartByte, frameVersion, payload length, payload, CRC-8 over version, length & payload.
+// The payload consists of fields made up of a measurement id (with frameInvalidFlag set if the sensor has no value) and a uint16 value in little endian
+#define frameCapability  ";F1"
+#define frameStartByte   0x02
+#define frameVersion     1
+#define frameInvalidFlag 0x80
+#define frameFieldSize   3
+
+// Snapshot frames. Advertised with snapshotCapability, only used together with frames. Same layout as a frame, but started with frameSnapshotStartByte
+// and always containing every field. The client acknowledges with a '=' message once it painted the whole state
+#define snapshotCapability     ";S"
+#define frameSnapshotStartByte 0x03
+
+// Credit based flow control. Advertised with creditCapability, the client grants a credit after every processed message
+#define creditCapability ";C"
+
+// Baud rate negotiation. The handshake always runs at 9600 baud, the server advertises the faster rates it supports after baudCapability
+#define baudCapability ";B"